@@ -0,0 +1,293 @@
+#include "edge_bundling.hpp"
+#include <algorithm>
+#include <cmath>
+
+static float dot(const Vector3& a, const Vector3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Point on the line through a and b closest to p
+static Vector3 project_onto_line(const Vector3& p, const Vector3& a, const Vector3& b) {
+    Vector3 ab = b - a;
+    float t = dot(p - a, ab) / dot(ab, ab);
+    return a + ab * t;
+}
+
+// How much of q, projected onto p's line, overlaps p (1 when centred on it)
+static float visibility(const Vector3& p0, const Vector3& p1, const Vector3& q0, const Vector3& q1) {
+    Vector3 i0 = project_onto_line(q0, p0, p1);
+    Vector3 i1 = project_onto_line(q1, p0, p1);
+    float span = Vector3::distance(i0, i1);
+    if (span < 1e-6f) return 0.0f;
+    Vector3 p_mid = (p0 + p1) * 0.5f;
+    Vector3 i_mid = (i0 + i1) * 0.5f;
+    return std::max(0.0f, 1.0f - 2.0f * Vector3::distance(p_mid, i_mid) / span);
+}
+
+// EdgeBundler methods
+float EdgeBundler::compatibility(const Vector3& p0, const Vector3& p1, const Vector3& q0, const Vector3& q1) {
+    Vector3 p = p1 - p0;
+    Vector3 q = q1 - q0;
+    float p_length = p.length();
+    float q_length = q.length();
+    if (p_length < 1e-6f || q_length < 1e-6f) return 0.0f;
+
+    // Angle, scale and position compatibility, then visibility (the costly one) last
+    float angle = std::abs(dot(p, q)) / (p_length * q_length);
+    float average = 0.5f * (p_length + q_length);
+    float scale = 2.0f / (average / std::min(p_length, q_length) + std::max(p_length, q_length) / average);
+    float position = average / (average + Vector3::distance((p0 + p1) * 0.5f, (q0 + q1) * 0.5f));
+    float partial = angle * scale * position;
+    if (partial <= 0.0f) return 0.0f;
+    return partial * std::min(visibility(p0, p1, q0, q1), visibility(q0, q1, p0, p1));
+}
+
+std::vector<std::vector<EdgeBundler::Compatible>> EdgeBundler::find_compatible_edges(
+    const std::vector<Vector3>& from, const std::vector<Vector3>& to, const std::vector<uint32_t>& active,
+    float threshold, uint32_t max_compatible, uint32_t max_candidates) {
+    size_t n = active.size();
+    std::vector<Vector3> mid(n);
+    std::vector<float> length(n);
+    std::vector<int> level(n);
+    for (size_t a = 0; a < n; a++) {
+        mid[a] = (from[active[a]] + to[active[a]]) * 0.5f;
+        length[a] = Vector3::distance(from[active[a]], to[active[a]]);
+        level[a] = std::ilogb(length[a]); // length in [2^level, 2^(level + 1))
+    }
+
+    // Compatibility is a product of factors no larger than 1, so each factor
+    // must reach the threshold: scale bounds the length ratio, position bounds
+    // the midpoint distance to (1 / threshold - 1) times the mean length
+    bool bounded = threshold > 0.0f;
+    float slack = bounded ? 1.0f / std::min(threshold, 1.0f) - 1.0f : 0.0f;
+    float max_ratio = 2.0f * (slack + std::sqrt(slack * slack + 1.0f)) - 1.0f;
+    int level_span = static_cast<int>(std::ceil(std::log2(max_ratio)));
+
+    // Grid per length level, cells twice the level's shortest length; the key
+    // orders (level, x, y, z) so each (level, x, y) column is one sorted run
+    const int64_t coord_limit = (1 << 18) - 1;
+    auto cell_coord = [&](float value, float cell) {
+        int64_t c = static_cast<int64_t>(std::floor(value / cell)) + (1 << 17);
+        return std::max<int64_t>(0, std::min(coord_limit, c));
+    };
+    auto cell_key = [](int lvl, int64_t x, int64_t y, int64_t z) {
+        return static_cast<uint64_t>(lvl + 256) << 54 | static_cast<uint64_t>(x) << 36 |
+               static_cast<uint64_t>(y) << 18 | static_cast<uint64_t>(z);
+    };
+    std::vector<std::pair<uint64_t, uint32_t>> cells(n);
+    for (size_t a = 0; a < n; a++) {
+        float cell = std::ldexp(1.0f, level[a] + 1);
+        cells[a] = {cell_key(level[a], cell_coord(mid[a].x, cell), cell_coord(mid[a].y, cell), cell_coord(mid[a].z, cell)),
+                    static_cast<uint32_t>(a)};
+    }
+    std::sort(cells.begin(), cells.end());
+
+    std::vector<std::vector<Compatible>> compatible(n);
+    std::vector<std::pair<float, Compatible>> found;
+    for (size_t a = 0; a < n; a++) {
+        const Vector3& p0 = from[active[a]];
+        const Vector3& p1 = to[active[a]];
+        found.clear();
+
+        // Each edge examines at most max_candidates others, nearest cells first,
+        // so a dense hairball costs O(edges) rather than O(edges^2)
+        size_t examined = 0;
+        auto scan = [&](uint64_t first_key, uint64_t last_key) {
+            auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(first_key, uint32_t(0)));
+            for (; it != cells.end() && it->first <= last_key && examined < max_candidates; ++it) {
+                uint32_t b = it->second;
+                if (b == a) continue;
+                examined++;
+                const Vector3& q0 = from[active[b]];
+                const Vector3& q1 = to[active[b]];
+                float value = compatibility(p0, p1, q0, q1);
+                if (value < threshold) continue;
+                found.push_back({value, Compatible{b, dot(p1 - p0, q1 - q0) < 0.0f}});
+            }
+        };
+
+        // A threshold of 0 accepts every pair: take the edges in grid order
+        if (!bounded) scan(0, UINT64_MAX);
+
+        // Levels nearest this edge's length first: 0, -1, +1, -2, +2, ...
+        for (int order = 0; bounded && order <= 2 * level_span && examined < max_candidates; order++) {
+            int lvl = level[a] + (order % 2 ? -(order + 1) / 2 : order / 2);
+
+            // Partners on this level are shorter than 2^(lvl + 1)
+            float cell = std::ldexp(1.0f, lvl + 1);
+            float radius = std::max(length[a], cell) * slack;
+            int64_t x0 = cell_coord(mid[a].x - radius, cell), x1 = cell_coord(mid[a].x + radius, cell);
+            int64_t y0 = cell_coord(mid[a].y - radius, cell), y1 = cell_coord(mid[a].y + radius, cell);
+            int64_t z0 = cell_coord(mid[a].z - radius, cell), z1 = cell_coord(mid[a].z + radius, cell);
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > static_cast<int64_t>(max_candidates)) {
+                // More columns than the budget (a loose threshold): take the level in order
+                scan(cell_key(lvl, 0, 0, 0), cell_key(lvl, coord_limit, coord_limit, coord_limit));
+                continue;
+            }
+
+            // (x, y) columns in square rings around the edge's own
+            int64_t cx = cell_coord(mid[a].x, cell), cy = cell_coord(mid[a].y, cell);
+            int64_t rings = std::max(std::max(cx - x0, x1 - cx), std::max(cy - y0, y1 - cy));
+            auto column = [&](int64_t x, int64_t y) {
+                if (x >= x0 && x <= x1 && y >= y0 && y <= y1) scan(cell_key(lvl, x, y, z0), cell_key(lvl, x, y, z1));
+            };
+            column(cx, cy);
+            for (int64_t r = 1; r <= rings && examined < max_candidates; r++) {
+                for (int64_t d = -r; d <= r; d++) {
+                    column(cx + d, cy - r);
+                    column(cx + d, cy + r);
+                }
+                for (int64_t d = -r + 1; d < r; d++) {
+                    column(cx - r, cy + d);
+                    column(cx + r, cy + d);
+                }
+            }
+        }
+
+        // Keep the strongest partners, bounding memory at max_compatible per edge
+        if (found.size() > max_compatible) {
+            std::nth_element(found.begin(), found.begin() + max_compatible, found.end(),
+                             [](const std::pair<float, Compatible>& x, const std::pair<float, Compatible>& y) {
+                                 return x.first > y.first;
+                             });
+            found.resize(max_compatible);
+        }
+        compatible[a].reserve(found.size());
+        for (const auto& entry : found) compatible[a].push_back(entry.second);
+    }
+    return compatible;
+}
+
+EdgeBundler::Result EdgeBundler::bundle(const std::vector<Vector3>& positions, const std::vector<uint64_t>& keys,
+                                        const BundlingParams& params, const Result* previous) {
+    Result result;
+    result.keys = keys;
+    int cycles = std::max(1, params.cycles);
+    result.points = (1u << cycles) - 1;
+    result.offsets.assign(keys.size() * result.points, Vector3(0, 0, 0));
+
+    // Slots that name a real, non-degenerate edge take part
+    std::vector<Vector3> from(keys.size()), to(keys.size());
+    std::vector<uint32_t> active;
+    float total_length = 0.0f;
+    for (uint32_t slot = 0; slot < keys.size(); slot++) {
+        if (keys[slot] == UINT64_MAX) continue;
+        uint32_t from_id = static_cast<uint32_t>(keys[slot] >> 32);
+        uint32_t to_id = static_cast<uint32_t>(keys[slot]);
+        if (from_id >= positions.size() || to_id >= positions.size()) continue;
+        from[slot] = positions[from_id];
+        to[slot] = positions[to_id];
+        float length = Vector3::distance(from[slot], to[slot]);
+        if (length < 1e-6f) continue;
+        active.push_back(slot);
+        total_length += length;
+    }
+    if (active.empty()) return result;
+    float mean_length = total_length / active.size();
+
+    std::vector<std::vector<Compatible>> compatible =
+        find_compatible_edges(from, to, active, params.compatibility, params.max_compatible,
+                              params.max_candidates);
+
+    // Start from one midpoint per edge; each cycle adds a point between every pair
+    uint32_t points = 1;
+    std::vector<Vector3> current(active.size());
+    for (size_t a = 0; a < active.size(); a++) current[a] = (from[active[a]] + to[active[a]]) * 0.5f;
+    std::vector<Vector3> next;
+
+    float step = params.step * mean_length;
+    float iterations = static_cast<float>(params.iterations);
+    int first_cycle = 0;
+
+    // Slots still naming the edge they held in the previous result keep its
+    // polyline; when most do, only the last cycle runs, and new edges start
+    // straight with the first-cycle step so they still travel into bundles
+    std::vector<uint8_t> warm(active.size(), 0);
+    size_t warm_count = 0;
+    if (previous && previous->points == result.points) {
+        for (size_t a = 0; a < active.size(); a++) {
+            uint32_t slot = active[a];
+            warm[a] = slot < previous->keys.size() && previous->keys[slot] == keys[slot];
+            warm_count += warm[a];
+        }
+    }
+    bool refine = warm_count * 2 >= active.size();
+    float cold_step = step;
+    if (refine) {
+        points = result.points;
+        current.resize(active.size() * points);
+        for (size_t a = 0; a < active.size(); a++) {
+            uint32_t slot = active[a];
+            for (uint32_t i = 0; i < points; i++) {
+                float t = static_cast<float>(i + 1) / (points + 1);
+                Vector3 p = from[slot] + (to[slot] - from[slot]) * t;
+                if (warm[a]) p = p + previous->offsets[static_cast<size_t>(slot) * points + i];
+                current[a * points + i] = p;
+            }
+        }
+        first_cycle = cycles - 1;
+        step = std::ldexp(step, -first_cycle);
+        iterations *= std::pow(2.0f / 3.0f, static_cast<float>(first_cycle));
+    }
+
+    for (int cycle = first_cycle; cycle < cycles; cycle++) {
+        int cycle_iterations = std::max(1, static_cast<int>(iterations));
+        for (int iteration = 0; iteration < cycle_iterations; iteration++) {
+            next.resize(current.size());
+            for (size_t a = 0; a < active.size(); a++) {
+                const Vector3& start = from[active[a]];
+                const Vector3& end = to[active[a]];
+                float spring = params.stiffness / (Vector3::distance(start, end) * (points + 1));
+                float edge_step = refine && !warm[a] ? cold_step : step;
+                const Vector3* own = &current[a * points];
+
+                for (uint32_t i = 0; i < points; i++) {
+                    const Vector3& p = own[i];
+                    const Vector3& before = i == 0 ? start : own[i - 1];
+                    const Vector3& after = i + 1 == points ? end : own[i + 1];
+                    Vector3 force = ((before - p) + (after - p)) * spring;
+
+                    // Unit pull towards the matching point of every compatible edge
+                    for (const Compatible& other : compatible[a]) {
+                        const Vector3& q = current[other.edge * points + (other.reversed ? points - 1 - i : i)];
+                        Vector3 d = q - p;
+                        float distance = d.length();
+                        if (distance > 1e-6f) force = force + d * (1.0f / distance);
+                    }
+                    next[a * points + i] = p + force * edge_step;
+                }
+            }
+            current.swap(next);
+        }
+        if (cycle + 1 == cycles) break;
+
+        // Subdivide: midpoints go in before, between and after the existing points
+        uint32_t new_points = points * 2 + 1;
+        next.resize(active.size() * new_points);
+        for (size_t a = 0; a < active.size(); a++) {
+            const Vector3* old_points = &current[a * points];
+            Vector3* out = &next[a * new_points];
+            Vector3 last_point = from[active[a]];
+            for (uint32_t i = 0; i < points; i++) {
+                *out++ = (last_point + old_points[i]) * 0.5f;
+                *out++ = old_points[i];
+                last_point = old_points[i];
+            }
+            *out = (last_point + to[active[a]]) * 0.5f;
+        }
+        current.swap(next);
+        points = new_points;
+        step *= 0.5f;
+        iterations *= 2.0f / 3.0f;
+    }
+
+    for (size_t a = 0; a < active.size(); a++) {
+        uint32_t slot = active[a];
+        for (uint32_t i = 0; i < points; i++) {
+            float t = static_cast<float>(i + 1) / (points + 1);
+            Vector3 straight = from[slot] + (to[slot] - from[slot]) * t;
+            result.offsets[static_cast<size_t>(slot) * points + i] = current[a * points + i] - straight;
+        }
+    }
+    return result;
+}
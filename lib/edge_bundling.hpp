@@ -0,0 +1,56 @@
+#pragma once
+
+#include "graph.hpp"
+#include <cstdint>
+#include <vector>
+
+// Force-directed edge bundling (Holten & van Wijk): every edge becomes a
+// polyline whose interior points are pulled towards the matching points of
+// compatible edges (similar direction, length and position) and held back by
+// springs along the edge. Works on a snapshot of the layout, so it can run on
+// a background thread while the layout keeps moving. Candidate pairs come from
+// a grid over edge midpoints and lengths, and a run can continue from an
+// earlier result instead of starting from straight lines.
+class EdgeBundler {
+public:
+    struct BundlingParams {
+        int cycles;            // interior points per edge go 1, 3, 7, 15, ... over the cycles
+        int iterations;        // first cycle; each later cycle runs 2/3 as many
+        float step;            // first-cycle step, relative to the mean edge length; halves each cycle
+        float stiffness;       // spring constant along each edge
+        float compatibility;   // minimum compatibility for two edges to attract
+        uint32_t max_compatible; // strongest partners kept per edge
+        uint32_t max_candidates; // edges each edge examines, nearest grid cells first
+
+        BundlingParams() : cycles(4), iterations(40), step(0.001f), stiffness(0.1f), compatibility(0.6f),
+                           max_compatible(32), max_candidates(512) {}
+    };
+
+    // Interior points are stored as offsets from the straight edge, so a result
+    // stays attached to its endpoints while they move until the next rebundle
+    struct Result {
+        uint32_t points = 0;            // interior points per edge
+        std::vector<uint64_t> keys;     // from << 32 | to of each bundled slot (UINT64_MAX: skipped)
+        std::vector<Vector3> offsets;   // `points` per slot: displacement from the straight edge
+    };
+
+    // keys[i] names edge slot i (UINT64_MAX for slots to leave straight);
+    // positions are indexed by node id. With a previous result whose slots
+    // mostly still name the same edges, the run skips the subdivision cycles
+    // and refines those polylines in place; other edges start straight.
+    static Result bundle(const std::vector<Vector3>& positions, const std::vector<uint64_t>& keys,
+                         const BundlingParams& params = BundlingParams(), const Result* previous = nullptr);
+
+private:
+    struct Compatible {
+        uint32_t edge;
+        bool reversed; // points run the other way along this edge
+    };
+
+    static float compatibility(const Vector3& p0, const Vector3& p1, const Vector3& q0, const Vector3& q1);
+    static std::vector<std::vector<Compatible>> find_compatible_edges(const std::vector<Vector3>& from,
+                                                                      const std::vector<Vector3>& to,
+                                                                      const std::vector<uint32_t>& active,
+                                                                      float threshold, uint32_t max_compatible,
+                                                                      uint32_t max_candidates);
+};
@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <zlib.h>
 
 char* read_file_raw(const char* filename, size_t* size) {
@@ -109,4 +112,90 @@ char* read_compressed_file(const char* filename, size_t* size) {
     free(compressed_data);
     
     return decompressed;
-}
\ No newline at end of file
+}
+FILE* decompress_zlib_file(const char* filename) {
+    if (!filename) return NULL;
+    
+    FILE* input = fopen(filename, "rb");
+    if (!input) return NULL;
+    FILE* output = tmpfile();
+    if (!output) {
+        fclose(input);
+        return NULL;
+    }
+    
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit(&strm) != Z_OK) {
+        fclose(input);
+        fclose(output);
+        return NULL;
+    }
+    
+    static const size_t CHUNK = 256 * 1024;
+    unsigned char* in = static_cast<unsigned char*>(malloc(CHUNK));
+    unsigned char* out = static_cast<unsigned char*>(malloc(CHUNK));
+    int ret = in && out ? Z_OK : Z_MEM_ERROR;
+    while (ret == Z_OK) {
+        strm.avail_in = static_cast<uInt>(fread(in, 1, CHUNK, input));
+        if (strm.avail_in == 0) {
+            ret = Z_DATA_ERROR; // truncated stream
+            break;
+        }
+        strm.next_in = in;
+        do {
+            strm.next_out = out;
+            strm.avail_out = CHUNK;
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) break;
+            size_t have = CHUNK - strm.avail_out;
+            if (fwrite(out, 1, have, output) != have) {
+                ret = Z_ERRNO;
+                break;
+            }
+        } while (strm.avail_out == 0 && ret != Z_STREAM_END);
+        if (ret == Z_BUF_ERROR) ret = Z_OK; // needs more input
+    }
+    
+    inflateEnd(&strm);
+    free(in);
+    free(out);
+    fclose(input);
+    if (ret != Z_STREAM_END || fflush(output) != 0) {
+        fclose(output);
+        return NULL;
+    }
+    rewind(output);
+    return output;
+}
+
+const char* map_file(FILE* file, size_t* size) {
+    if (!file || !size) return NULL;
+    
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0 || info.st_size <= 0) return NULL;
+    
+    void* data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED) return NULL;
+    madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    
+    *size = static_cast<size_t>(info.st_size);
+    return static_cast<const char*>(data);
+}
+
+void unmap_file(const char* data, size_t size) {
+    if (data) munmap(const_cast<char*>(data), size);
+}
+
+bool read_file_range(FILE* file, size_t offset, size_t size, char* out) {
+    if (!file || !out) return false;
+    
+    while (size > 0) {
+        ssize_t got = pread(fileno(file), out, size, static_cast<off_t>(offset));
+        if (got <= 0) return false;
+        out += got;
+        offset += static_cast<size_t>(got);
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
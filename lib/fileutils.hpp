@@ -1,7 +1,17 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdio.h>
 
 char* read_file_raw(const char* filename, size_t* size);
 char* decompress_zlib_data(const char* compressed_data, size_t compressed_size, size_t* decompressed_size);
-char* read_compressed_file(const char* filename, size_t* size);
\ No newline at end of file
+char* read_compressed_file(const char* filename, size_t* size);
+
+// Inflate a zlib file a chunk at a time into an anonymous temporary file,
+// rewound to the start; NULL on failure
+FILE* decompress_zlib_file(const char* filename);
+// Map an open file read-only (NULL on failure or when empty); release with unmap_file
+const char* map_file(FILE* file, size_t* size);
+void unmap_file(const char* data, size_t size);
+// Read size bytes at offset without moving the file position; safe across threads
+bool read_file_range(FILE* file, size_t offset, size_t size, char* out);
\ No newline at end of file
@@ -6,6 +6,8 @@
 // Smooth fractional axis weight: 0 -> near-locked (epsilon), 1 -> fully enabled
 static inline float axis_weight(float dimension, float axisIndex) { return 0.001f + 0.999f * std::min(1.0f, std::max(0.0f, dimension - axisIndex)); }
 
+bool ForceLayoutEngine::step_restart_requested = false;
+
 void ForceLayoutEngine::apply_force_layout(Graph3D& graph, const PhysicsParams& params) {
     if (graph.node_count == 0) return;
 
@@ -72,6 +74,10 @@ bool ForceLayoutEngine::apply_force_layout_step(Graph3D& graph, const PhysicsPar
 
     static std::vector<NodePhysics> physics_nodes;
     static bool initialized = false;
+    if (step_restart_requested) {
+        initialized = false;
+        step_restart_requested = false;
+    }
 
     // Initialize on first call OR when graph changes OR when nodes have been reset
     bool nodes_were_reset = false;
@@ -88,7 +94,17 @@ bool ForceLayoutEngine::apply_force_layout_step(Graph3D& graph, const PhysicsPar
         }
     }
 
-    if (!initialized || physics_nodes.size() != graph.node_count || nodes_were_reset) {
+    if (initialized && !nodes_were_reset && graph.node_count > physics_nodes.size()) {
+        // Graph grew (followed replay): keep existing momentum, new nodes start at rest
+        size_t old_count = physics_nodes.size();
+        physics_nodes.resize(graph.node_count);
+        for (uint32_t i = static_cast<uint32_t>(old_count); i < graph.node_count; i++) {
+            physics_nodes[i].node_id = i;
+            physics_nodes[i].position = graph.nodes[i].position;
+            physics_nodes[i].velocity = Vector3(0, 0, 0);
+            physics_nodes[i].force = Vector3(0, 0, 0);
+        }
+    } else if (!initialized || physics_nodes.size() != graph.node_count || nodes_were_reset) {
         physics_nodes.resize(graph.node_count);
 
         for (uint32_t i = 0; i < graph.node_count; i++) {
@@ -173,7 +189,7 @@ void ForceLayoutEngine::compute_attraction_forces(std::vector<NodePhysics>& phys
         if (distance < 0.1f) continue;
 
         Vector3 normalized = diff.normalize();
-        float force_magnitude = attract_strength * distance;
+        float force_magnitude = attract_strength * distance * edge.weight; // merged edges pull as hard as the originals did
         Vector3 force = normalized * force_magnitude;
 
         physics_nodes[from_id].force = physics_nodes[from_id].force + force;
@@ -24,8 +24,12 @@ public:
     
     static void apply_force_layout(Graph3D& graph, const PhysicsParams& params = PhysicsParams());
     static bool apply_force_layout_step(Graph3D& graph, const PhysicsParams& params, int& remaining_iterations);
+    // The graph's nodes were replaced: the next step restarts from their positions
+    static void restart_layout_step() { step_restart_requested = true; }
     
 private:
+    static bool step_restart_requested;
+
     struct NodePhysics {
         Vector3 position;
         Vector3 velocity;
@@ -1,11 +1,13 @@
 #include "graph.hpp"
 #include "fileutils.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <cjson/cJSON.h>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 
 // Vector3 implementation
 float Vector3::length() const {
@@ -57,6 +59,11 @@ Graph3D::Graph3D() : node_count(0), edge_count(0), center(0, 0, 0), scale(1.0f)
 Graph3D::~Graph3D() {
 }
 
+void Graph3D::clear() {
+    node_count = 0;
+    edge_count = 0;
+}
+
 uint32_t Graph3D::add_node(const Vector3& position, const Color& color, float radius, const std::string& label) {
     if (node_count >= MAX_NODES) return UINT32_MAX;
     
@@ -90,11 +97,41 @@ void Graph3D::add_edge(uint32_t from_id, uint32_t to_id, const Color& color, flo
     edge->to_id = to_id;
     edge->color = color;
     edge->thickness = thickness;
+    edge->weight = 1.0f;
     edge->visible = true;
     
     edge_count++;
 }
 
+uint32_t Graph3D::merge_parallel_edges(bool undirected) {
+    // First edge of each (from, to) pair keeps its slot; later ones fold into it
+    std::unordered_map<uint64_t, uint32_t> first_edge;
+    first_edge.reserve(edge_count);
+    
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < edge_count; i++) {
+        GraphEdge edge = edges[i];
+        uint32_t a = edge.from_id, b = edge.to_id;
+        if (undirected && b < a) std::swap(a, b);
+        uint64_t pair = (static_cast<uint64_t>(a) << 32) | b;
+        
+        auto found = first_edge.find(pair);
+        if (found != first_edge.end()) {
+            GraphEdge& merged = edges[found->second];
+            merged.weight += edge.weight;
+            merged.thickness = std::max(merged.thickness, edge.thickness);
+            merged.visible = merged.visible || edge.visible;
+            continue;
+        }
+        first_edge.emplace(pair, kept);
+        edges[kept++] = edge;
+    }
+    
+    uint32_t removed = edge_count - kept;
+    edge_count = kept;
+    return removed;
+}
+
 void Graph3D::update_physics(float delta_time) {
     const float damping = 0.95f;
     const float repulsion_strength = 50.0f;
@@ -136,7 +173,7 @@ void Graph3D::update_physics(float delta_time) {
         
         if (distance > min_distance) {
             Vector3 normalized = diff.normalize();
-            float force_magnitude = attraction_strength * distance;
+            float force_magnitude = attraction_strength * distance * edge->weight;
             Vector3 force = normalized * force_magnitude;
             
             from->force = from->force + force;
@@ -222,6 +259,7 @@ bool Graph3D::load_from_json(const std::string& filename) {
             add_edge(from_id, to_id, edge_color, edge_thickness);
         }
     }
+    merge_parallel_edges();
     
     cJSON_Delete(json);
     return true;
@@ -296,6 +334,7 @@ bool Graph3D::load_from_compressed_json(const std::string& filename) {
             add_edge(from_id, to_id, edge_color, edge_thickness);
         }
     }
+    merge_parallel_edges();
     
     cJSON_Delete(json);
     return true;
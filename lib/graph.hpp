@@ -69,6 +69,7 @@ struct GraphEdge {
     uint32_t to_id;
     Color color;
     float thickness;
+    float weight;            // Parallel edges merged into this one (1 for a plain edge)
     bool visible;
 };
 
@@ -90,5 +91,9 @@ public:
     bool load_from_json(const std::string& filename);
     bool load_from_compressed_json(const std::string& filename);
     void generate_sample();
+    // Merge parallel edges (and reverse ones too when undirected) into a single
+    // edge whose weight sums theirs; returns how many edges were removed
+    uint32_t merge_parallel_edges(bool undirected = false);
+    void clear(); // Drop all nodes and edges
     void center_graph(); // Center all nodes around origin
 };
\ No newline at end of file
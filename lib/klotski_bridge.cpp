@@ -49,6 +49,11 @@ void KlotskiGraph::convert_to_graph3d(Graph3D& graph3d) const {
             graph3d.add_edge(from_iter->second, to_iter->second, edge.color, edge.thickness);
         }
     }
+    
+    // Moves are reversible and repeated boards share a node, so the same pair
+    // can appear several times: keep one weighted edge per pair
+    uint32_t merged = graph3d.merge_parallel_edges(true);
+    if (merged > 0) std::cout << "Merged " << merged << " duplicate Klotski edges" << std::endl;
 }
 
 double KlotskiGraph::string_to_hash(const std::string& board_rep) const {
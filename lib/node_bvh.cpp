@@ -0,0 +1,93 @@
+#include "node_bvh.hpp"
+#include <algorithm>
+
+static NodeBVH::Box empty_box() {
+    return NodeBVH::Box{Vector3(1e30f, 1e30f, 1e30f), Vector3(-1e30f, -1e30f, -1e30f)};
+}
+
+static void grow(NodeBVH::Box& box, const Vector3& p) {
+    box.min = Vector3(std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z));
+    box.max = Vector3(std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z));
+}
+
+static void grow(NodeBVH::Box& box, const NodeBVH::Box& other) {
+    grow(box, other.min);
+    grow(box, other.max);
+}
+
+static float surface_area(const NodeBVH::Box& box) {
+    Vector3 d = box.max - box.min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// NodeBVH methods
+void NodeBVH::build(const Graph3D& graph) {
+    tree.clear();
+    node_ids.resize(graph.node_count);
+    for (uint32_t i = 0; i < graph.node_count; i++) node_ids[i] = i;
+    if (graph.node_count == 0) return;
+
+    tree.reserve(2 * (graph.node_count / LEAF_SIZE + 1));
+    tree.emplace_back();
+    build_range(0, graph, 0, graph.node_count);
+    built_leaf_area = std::max(leaf_area(), 1e-3f); // coincident nodes: any spread counts as loose
+}
+
+void NodeBVH::build_range(uint32_t index, const Graph3D& graph, uint32_t first, uint32_t span) {
+    Box box = empty_box();
+    for (uint32_t i = first; i < first + span; i++) grow(box, graph.nodes[node_ids[i]].position);
+    tree[index].box = box;
+    tree[index].first = first;
+    tree[index].span = span;
+    tree[index].count = 0;
+    tree[index].left = 0;
+
+    if (span <= LEAF_SIZE) {
+        tree[index].count = span;
+        return;
+    }
+
+    // Median split along the widest axis
+    Vector3 extent = box.max - box.min;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto coordinate = [&](uint32_t id) {
+        const Vector3& p = graph.nodes[id].position;
+        return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+    };
+    uint32_t half = span / 2;
+    std::nth_element(node_ids.begin() + first, node_ids.begin() + first + half, node_ids.begin() + first + span,
+                     [&](uint32_t a, uint32_t b) { return coordinate(a) < coordinate(b); });
+
+    uint32_t left = static_cast<uint32_t>(tree.size());
+    tree[index].left = left;
+    tree.emplace_back();
+    tree.emplace_back();
+    build_range(left, graph, first, half);
+    build_range(left + 1, graph, first + half, span - half);
+}
+
+void NodeBVH::refit(const Graph3D& graph) {
+    // Children always sit after their parent, so a reverse sweep is bottom-up
+    for (size_t i = tree.size(); i-- > 0;) {
+        TreeNode& node = tree[i];
+        node.box = empty_box();
+        if (node.count > 0) {
+            for (uint32_t k = node.first; k < node.first + node.count; k++) grow(node.box, graph.nodes[node_ids[k]].position);
+        } else {
+            grow(node.box, tree[node.left].box);
+            grow(node.box, tree[node.left + 1].box);
+        }
+    }
+}
+
+float NodeBVH::leaf_area() const {
+    float area = 0.0f;
+    for (const TreeNode& node : tree) {
+        if (node.count > 0) area += surface_area(node.box);
+    }
+    return area;
+}
+
+float NodeBVH::looseness() const {
+    return tree.empty() ? 1.0f : leaf_area() / built_leaf_area;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "graph.hpp"
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over graph node positions, for view culling. The
+// tree shape is built once per node set (median splits on the widest axis);
+// refit() recomputes the boxes bottom-up after layout steps, and the caller
+// rebuilds when refitting has let the boxes grow too loose.
+class NodeBVH {
+public:
+    struct Box {
+        Vector3 min;
+        Vector3 max;
+    };
+    enum class Overlap { Outside, Partial, Inside };
+
+    void build(const Graph3D& graph);
+    void refit(const Graph3D& graph);
+    bool empty() const { return tree.empty(); }
+    uint32_t built_node_count() const { return static_cast<uint32_t>(node_ids.size()); }
+    // Leaf box area relative to right after build; grows as refits loosen the tree
+    float looseness() const;
+
+    // classify(box) -> Overlap. Calls emit(ids, count, inside) for every subtree
+    // classified Inside and every leaf classified Partial; Outside subtrees are
+    // skipped without visiting their nodes.
+    template <typename Classify, typename Emit>
+    void query(Classify&& classify, Emit&& emit) const {
+        if (tree.empty()) return;
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const TreeNode& node = tree[stack[--top]];
+            Overlap overlap = classify(node.box);
+            if (overlap == Overlap::Outside) continue;
+            if (overlap == Overlap::Inside || node.count > 0) {
+                emit(&node_ids[node.first], node.count > 0 ? node.count : node.span, overlap == Overlap::Inside);
+                continue;
+            }
+            stack[top++] = node.left;
+            stack[top++] = node.left + 1;
+        }
+    }
+
+    // Level-of-detail cut: like query(), but collapse(box, ids, span) is asked
+    // about every subtree that is not Outside before descending into it, and
+    // returning true consumes the whole subtree (its nodes are not emitted).
+    // Inside subtrees are descended without reclassifying their children.
+    template <typename Classify, typename Emit, typename Collapse>
+    void query(Classify&& classify, Emit&& emit, Collapse&& collapse) const {
+        if (tree.empty()) return;
+        uint32_t stack[64]; // tree index << 1 | known inside
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            uint32_t entry = stack[--top];
+            const TreeNode& node = tree[entry >> 1];
+            Overlap overlap = (entry & 1) ? Overlap::Inside : classify(node.box);
+            if (overlap == Overlap::Outside) continue;
+            if (collapse(node.box, &node_ids[node.first], node.span)) continue;
+            if (node.count > 0) {
+                emit(&node_ids[node.first], node.count, overlap == Overlap::Inside);
+                continue;
+            }
+            uint32_t inside = overlap == Overlap::Inside ? 1 : 0;
+            stack[top++] = node.left << 1 | inside;
+            stack[top++] = (node.left + 1) << 1 | inside;
+        }
+    }
+
+private:
+    static constexpr uint32_t LEAF_SIZE = 8;
+
+    struct TreeNode {
+        Box box;
+        uint32_t first;  // into node_ids
+        uint32_t span;   // node_ids covered by the subtree
+        uint32_t count;  // > 0 for leaves
+        uint32_t left;   // children are left and left + 1
+    };
+
+    void build_range(uint32_t index, const Graph3D& graph, uint32_t first, uint32_t span);
+    float leaf_area() const;
+
+    std::vector<TreeNode> tree;
+    std::vector<uint32_t> node_ids;
+    float built_leaf_area = 0.0f;
+};
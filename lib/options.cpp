@@ -11,6 +11,9 @@ bool parse_command_line(int argc, char* argv[], CommandLineArgs* args) {
     
     static struct option long_options[] = {
         {"file", required_argument, 0, 'f'},
+        {"agent", required_argument, 0, 'a'},
+        {"follow", no_argument, 0, 'F'},
+        {"states", required_argument, 0, 's'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'v'},
         {0, 0, 0, 0}
@@ -19,22 +22,32 @@ bool parse_command_line(int argc, char* argv[], CommandLineArgs* args) {
     int c;
     int option_index = 0;
     
-    while ((c = getopt_long(argc, argv, "f:hv", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "f:a:Fs:hv", long_options, &option_index)) != -1) {
         switch (c) {
             case 'f': {
                 if (args->input_file) {
                     free(args->input_file);
                 }
                 args->input_file = strdup(optarg);
+                args->compressed = is_compressed_filename(optarg);
+                break;
+            }
+                
+            case 'a':
+                args->single_agent = true;
+                args->agent_id = atoi(optarg);
+                break;
                 
-                size_t len = strlen(optarg);
-                if (len > 2 && strcmp(optarg + len - 2, ".z") == 0) {
-                    args->compressed = true;
-                } else if (len > 6 && strcmp(optarg + len - 6, ".json.z") == 0) {
-                    args->compressed = true;
+            case 'F':
+                args->follow = true;
+                break;
+                
+            case 's':
+                if (args->state_spec) {
+                    free(args->state_spec);
                 }
+                args->state_spec = strdup(optarg);
                 break;
-            }
                 
             case 'h':
                 args->help = true;
@@ -54,24 +67,38 @@ bool parse_command_line(int argc, char* argv[], CommandLineArgs* args) {
     
     if (optind < argc && !args->input_file) {
         args->input_file = strdup(argv[optind]);
-        
-        size_t len = strlen(argv[optind]);
-        if (len > 2 && strcmp(argv[optind] + len - 2, ".z") == 0) {
-            args->compressed = true;
-        } else if (len > 6 && strcmp(argv[optind] + len - 6, ".json.z") == 0) {
-            args->compressed = true;
-        }
+        args->compressed = is_compressed_filename(argv[optind]);
+        optind++;
+    }
+    
+    // Any remaining files are further episodes for an aggregate graph
+    if (optind < argc) {
+        args->extra_files = &argv[optind];
+        args->extra_file_count = argc - optind;
     }
     
     return true;
 }
 
+bool is_compressed_filename(const char* filename) {
+    size_t len = strlen(filename);
+    if (len > 2 && strcmp(filename + len - 2, ".z") == 0) {
+        return true;
+    } else if (len > 6 && strcmp(filename + len - 6, ".json.z") == 0) {
+        return true;
+    }
+    return false;
+}
+
 void print_usage(const char* program_name) {
-    printf("Usage: %s [OPTIONS] [FILE]\n\n", program_name);
+    printf("Usage: %s [OPTIONS] [FILE...]\n\n", program_name);
     printf("Graphew - 3D Graph Renderer\n");
     printf("Visualize graphs from JSON files with interactive 3D rendering\n\n");
     printf("Options:\n");
     printf("  -f, --file FILE     Load graph from JSON file (supports .json.z compression)\n");
+    printf("  -a, --agent ID      Lazily load the replay and graph only agent ID\n");
+    printf("  -F, --follow        Keep reading a replay that is still being written (JSON Lines)\n");
+    printf("  -s, --states SPEC   State dimensions and binning, e.g. \"ore_red:log;time:/250;reward:/2\"\n");
     printf("  -h, --help          Show this help message\n");
     printf("  -v, --version       Show version information\n\n");
     printf("Controls:\n");
@@ -86,6 +113,9 @@ void print_usage(const char* program_name) {
     printf("  %s graph.json                # Load uncompressed JSON\n", program_name);
     printf("  %s -f replay.json.z          # Load zlib compressed JSON\n", program_name);
     printf("  %s --file data.json.z        # Load zlib compressed JSON (long form)\n", program_name);
+    printf("  %s -F run/replay.jsonl       # Watch a live training run\n", program_name);
+    printf("  %s eval/ep*.json.z           # Merge many episodes into one state graph\n", program_name);
+    printf("  %s -s \"heart:0,1,3;time:/500\" replay.json  # Coarser state abstraction\n", program_name);
 }
 
 void print_version(void) {
@@ -99,4 +129,8 @@ void cleanup_args(CommandLineArgs* args) {
         free(args->input_file);
         args->input_file = NULL;
     }
+    if (args && args->state_spec) {
+        free(args->state_spec);
+        args->state_spec = NULL;
+    }
 }
\ No newline at end of file
@@ -7,9 +7,16 @@ typedef struct {
     bool version;
     char* input_file;
     bool compressed;
+    bool single_agent;   // -a: lazily load and graph only this agent
+    int agent_id;
+    bool follow;         // -F: tail a growing JSON Lines replay (file or FIFO)
+    char* state_spec;    // -s: state abstraction spec (see StateSpec)
+    char** extra_files;  // further replays after the first: merged into one aggregate graph
+    int extra_file_count;
 } CommandLineArgs;
 
 bool parse_command_line(int argc, char* argv[], CommandLineArgs* args);
 void print_usage(const char* program_name);
 void print_version(void);
+bool is_compressed_filename(const char* filename);
 void cleanup_args(CommandLineArgs* args);
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <thread>
 
 GraphRenderer::GraphRenderer()
     : zoom_level(1.0f), zoom_speed(0.1f), view_center(0, 0),
@@ -42,6 +43,11 @@ void GraphRenderer::init_window(const std::string& title) {
     window.setView(view);
     load_ui_font();
     clear_sliders();
+    update_camera_transform();
+
+    // Bake every sphere size up front so zooming never builds textures mid-frame
+    layout_sphere_atlas();
+    upload_sphere_atlas(bake_sphere_atlas_pixels(lighting));
 
 #ifdef __APPLE__
     // Initialize macOS gesture monitoring
@@ -172,6 +178,25 @@ void GraphRenderer::draw_ui_sliders() {
     window.setView(original_view);
 }
 
+void GraphRenderer::draw_frame_stats() {
+    if (!show_frame_stats || !ui_font_loaded) return;
+    sf::View original_view = window.getView();
+    window.setView(window.getDefaultView());
+
+    char buf[200];
+    std::snprintf(buf, sizeof(buf), "Nodes: %u drawn, %u in %u clusters, %u culled   Edges: %u drawn, %u bundled, %u culled",
+                  frame_stats.nodes_drawn, frame_stats.nodes_clustered, frame_stats.clusters_drawn, frame_stats.nodes_culled,
+                  frame_stats.edges_drawn, frame_stats.edges_bundled, frame_stats.edges_culled);
+    sf::Text txt(ui_font);
+    txt.setString(buf);
+    txt.setCharacterSize(14);
+    txt.setFillColor(sf::Color(200, 200, 215, 200));
+    txt.setPosition(sf::Vector2f(10.f, static_cast<float>(window.getSize().y) - 24.f));
+    window.draw(txt);
+
+    window.setView(original_view);
+}
+
 void GraphRenderer::handle_events() {
     std::optional<sf::Event> event;
     while ((event = window.pollEvent())) {
@@ -312,6 +337,18 @@ void GraphRenderer::handle_events() {
                 show_axes = !show_axes;
                 std::cout << "Axes " << (show_axes ? "shown" : "hidden") << std::endl;
             }
+            else if (keyPress->code == sf::Keyboard::Key::C) {
+                lod_enabled = !lod_enabled;
+                std::cout << "Cluster LOD " << (lod_enabled ? "enabled" : "disabled") << std::endl;
+            }
+            else if (keyPress->code == sf::Keyboard::Key::M) {
+                density_mode = !density_mode;
+                std::cout << "Density splat mode " << (density_mode ? "enabled" : "disabled") << std::endl;
+            }
+            else if (keyPress->code == sf::Keyboard::Key::B) {
+                edge_bundling = !edge_bundling;
+                std::cout << "Edge bundling " << (edge_bundling ? "enabled" : "disabled") << std::endl;
+            }
             else if (keyPress->code == sf::Keyboard::Key::H) {
                 show_help = !show_help;
                 std::cout << "Help " << (show_help ? "shown" : "hidden") << std::endl;
@@ -583,39 +620,300 @@ void GraphRenderer::update_camera_position() {
     camera_position.x = camera_target.x + camera_distance * std::cos(camera_angle_v) * std::cos(camera_angle_h);
     camera_position.y = camera_target.y + camera_distance * std::sin(camera_angle_v);
     camera_position.z = camera_target.z + camera_distance * std::cos(camera_angle_v) * std::sin(camera_angle_h);
+    update_camera_transform();
 }
 
-sf::Vector2f GraphRenderer::world_to_screen_3d(const Vector3& world_pos) {
-    // PROPER ORTHOGRAPHIC PROJECTION: camera target at screen center, other points spread out
+void GraphRenderer::update_camera_transform() {
+    // PROPER ORTHOGRAPHIC PROJECTION: camera target at screen center, other points spread out.
+    // Offsets from the target are rotated horizontally (around Y), then vertically
+    // (around X), scaled by zoom and shifted by the panned view_center; folding all
+    // of that into affine rows means projecting a point is three dot products.
     sf::Vector2u window_size = window.getSize();
-
-    // Calculate offset from camera target
-    Vector3 offset = world_pos - camera_target;
-
-    // Apply both horizontal and vertical rotations
     float cos_h = std::cos(camera_angle_h);
     float sin_h = std::sin(camera_angle_h);
     float cos_v = std::cos(camera_angle_v);
     float sin_v = std::sin(camera_angle_v);
 
-    // First apply horizontal rotation (around Y axis)
-    float temp_x = offset.x * cos_h - offset.z * sin_h;
-    float temp_z = offset.x * sin_h + offset.z * cos_h;
-
-    // Then apply vertical rotation (around X axis)
-    float final_x = temp_x;
-    float final_y = offset.y * cos_v - temp_z * sin_v;
-    // float final_z = offset.y * sin_v + temp_z * cos_v; // Z not used in 2D projection
-
     // Scale based on camera distance for proper zoom functionality
     float base_scale = 15.0f;
     float zoom_scale = base_scale * (50.0f / camera_distance); // Closer camera = bigger scale = zoomed in
+    float center_x = window_size.x / 2.0f - view_center.x;
+    float center_y = window_size.y / 2.0f - view_center.y;
+    const Vector3& t = camera_target;
+
+    // screen_x = center_x + zoom * (dx cos_h - dz sin_h)
+    float* sx = camera_transform.rows[0];
+    sx[0] = zoom_scale * cos_h;
+    sx[1] = 0.0f;
+    sx[2] = -zoom_scale * sin_h;
+    sx[3] = center_x - (sx[0] * t.x + sx[2] * t.z);
+
+    // screen_y = center_y - zoom * (dy cos_v - (dx sin_h + dz cos_h) sin_v)
+    float* sy = camera_transform.rows[1];
+    sy[0] = zoom_scale * sin_h * sin_v;
+    sy[1] = -zoom_scale * cos_v;
+    sy[2] = zoom_scale * cos_h * sin_v;
+    sy[3] = center_y - (sy[0] * t.x + sy[1] * t.y + sy[2] * t.z);
+
+    // depth = (scale_for_render(p) - scale_for_render(camera_position)) . forward
+    Vector3 eye = scale_for_render(camera_position);
+    Vector3 forward = (scale_for_render(camera_target) - eye).normalize();
+    float* depth = camera_transform.rows[2];
+    depth[0] = forward.x;
+    depth[1] = forward.y * axis_weight_render(render_dimension, 1.0f);
+    depth[2] = forward.z * axis_weight_render(render_dimension, 2.0f);
+    depth[3] = -(forward.x * eye.x + forward.y * eye.y + forward.z * eye.z);
+}
+
+sf::Vector2f GraphRenderer::world_to_screen_3d(const Vector3& world_pos) {
+    const float* sx = camera_transform.rows[0];
+    const float* sy = camera_transform.rows[1];
+    return sf::Vector2f(sx[0] * world_pos.x + sx[1] * world_pos.y + sx[2] * world_pos.z + sx[3],
+                        sy[0] * world_pos.x + sy[1] * world_pos.y + sy[2] * world_pos.z + sy[3]);
+}
+
+void GraphRenderer::project_nodes(const Graph3D& graph) {
+    size_t count = graph.node_count;
+    projected.x.resize(count);
+    projected.y.resize(count);
+    projected.depth.resize(count);
+    projected.radius.resize(count);
+    projected.fog.resize(count);
+
+    // Gather positions out of the (wide) node structs, then transform the
+    // packed arrays in place in a branch-free loop the compiler can vectorise
+    float* xs = projected.x.data();
+    float* ys = projected.y.data();
+    float* zs = projected.depth.data();
+    float* radii = projected.radius.data();
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = graph.nodes[i].position.x;
+        ys[i] = graph.nodes[i].position.y;
+        zs[i] = graph.nodes[i].position.z;
+        radii[i] = graph.nodes[i].radius;
+    }
+
+    // Which nodes moved since the last frame (new nodes count as moved)
+    size_t known_nodes = std::min(last_node_positions.size(), count);
+    node_moved.assign(count, 1);
+    last_node_positions.resize(count);
+    any_node_moved = known_nodes != count;
+    for (size_t i = 0; i < count; i++) {
+        const Vector3& p = graph.nodes[i].position;
+        Vector3& q = last_node_positions[i];
+        if (i < known_nodes) node_moved[i] = p.x != q.x || p.y != q.y || p.z != q.z;
+        any_node_moved = any_node_moved || node_moved[i];
+        q = p;
+    }
+
+    const float (&m)[3][4] = camera_transform.rows;
+    for (size_t i = 0; i < count; i++) {
+        float x = xs[i], y = ys[i], z = zs[i];
+        xs[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+        ys[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+        zs[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+    }
+
+    // Depth-based sizing (apply_perspective with the focal term hoisted) and fog
+    float focal_scale = apply_perspective(1.0f);
+    projected_max_radius = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float visual_radius = radii[i] * (focal_scale / std::max(zs[i], 0.1f)) * 0.5f;
+        radii[i] = std::max(2.0f, std::min(visual_radius, 50.0f));
+        projected_max_radius = std::max(projected_max_radius, radii[i]);
+        projected.fog[i] = fog_factor(zs[i]);
+    }
+}
+
+void GraphRenderer::cull_nodes(const Graph3D& graph) {
+    uint32_t count = graph.node_count;
+    if (node_bvh.built_node_count() != count) {
+        node_bvh.build(graph);
+    } else if (any_node_moved) {
+        // Layout steps move nodes a little: refit keeps the tree, rebuild once it gets loose
+        node_bvh.refit(graph);
+        if (node_bvh.looseness() > 2.0f) node_bvh.build(graph);
+    }
+
+    // Screen-space centre and half extents of a box under the (affine) camera transform
+    const float (&m)[3][4] = camera_transform.rows;
+    auto screen_rect = [&](const NodeBVH::Box& box, float& cx, float& cy, float& hx, float& hy) {
+        Vector3 c = (box.min + box.max) * 0.5f;
+        Vector3 h = (box.max - box.min) * 0.5f;
+        cx = m[0][0] * c.x + m[0][1] * c.y + m[0][2] * c.z + m[0][3];
+        cy = m[1][0] * c.x + m[1][1] * c.y + m[1][2] * c.z + m[1][3];
+        hx = std::abs(m[0][0]) * h.x + std::abs(m[0][1]) * h.y + std::abs(m[0][2]) * h.z;
+        hy = std::abs(m[1][0]) * h.x + std::abs(m[1][1]) * h.y + std::abs(m[1][2]) * h.z;
+    };
+
+    // A box is off-screen if its projected bounds, grown by the largest node
+    // radius, miss the window; fully on-screen boxes accept all their nodes
+    sf::Vector2u window_size = window.getSize();
+    float width = static_cast<float>(window_size.x);
+    float height = static_cast<float>(window_size.y);
+    float margin = projected_max_radius;
+    auto classify = [&](const NodeBVH::Box& box) {
+        float cx, cy, hx, hy;
+        screen_rect(box, cx, cy, hx, hy);
+        if (cx + hx + margin < 0.0f || cx - hx - margin > width || cy + hy + margin < 0.0f || cy - hy - margin > height) {
+            return NodeBVH::Overlap::Outside;
+        }
+        if (cx - hx >= 0.0f && cx + hx <= width && cy - hy >= 0.0f && cy + hy <= height) {
+            return NodeBVH::Overlap::Inside;
+        }
+        return NodeBVH::Overlap::Partial;
+    };
+    auto on_screen = [&](float x, float y, float r) {
+        return x + r >= 0.0f && x - r <= width && y + r >= 0.0f && y - r <= height;
+    };
+    auto emit = [&](const uint32_t* ids, uint32_t id_count, bool inside) {
+        for (uint32_t k = 0; k < id_count; k++) {
+            uint32_t id = ids[k];
+            node_in_view[id] = inside || on_screen(projected.x[id], projected.y[id], projected.radius[id]);
+        }
+    };
+
+    // Collapse a subtree of two or more visible nodes that covers only a few pixels
+    auto collapse = [&](const NodeBVH::Box& box, const uint32_t* ids, uint32_t span) {
+        if (span < 2) return false;
+        float cx, cy, hx, hy;
+        screen_rect(box, cx, cy, hx, hy);
+        if (2.0f * std::max(hx, hy) > lod_cluster_pixels) return false;
+
+        NodeCluster cluster{Vector3(0, 0, 0), sf::Vector2f(), sf::Color(), 0.0f, 0.0f, 0};
+        float r = 0, g = 0, b = 0, a = 0, area = 0;
+        for (uint32_t k = 0; k < span; k++) {
+            const GraphNode& node = graph.nodes[ids[k]];
+            if (!node.visible) continue;
+            cluster.centroid = cluster.centroid + node.position;
+            cluster.depth += projected.depth[ids[k]];
+            r += node.color.r; g += node.color.g; b += node.color.b; a += node.color.a;
+            area += projected.radius[ids[k]] * projected.radius[ids[k]];
+            cluster.members++;
+        }
+        if (cluster.members < 2) return false;
+
+        float inv = 1.0f / cluster.members;
+        cluster.centroid = cluster.centroid * inv;
+        cluster.depth *= inv;
+        cluster.color = sf::Color(static_cast<uint8_t>(r * inv), static_cast<uint8_t>(g * inv),
+                                  static_cast<uint8_t>(b * inv), static_cast<uint8_t>(a * inv));
+        cluster.radius = std::min(std::sqrt(area), 50.0f);
+        cluster.screen = world_to_screen_3d(cluster.centroid);
+        if (!on_screen(cluster.screen.x, cluster.screen.y, cluster.radius)) return true;
+
+        // The member nearest the mean depth stands in for the cluster in the draw order
+        int32_t index = static_cast<int32_t>(node_clusters.size());
+        uint32_t representative = UINT32_MAX;
+        float best = 0.0f;
+        for (uint32_t k = 0; k < span; k++) {
+            uint32_t id = ids[k];
+            if (!graph.nodes[id].visible) continue;
+            float distance = std::abs(projected.depth[id] - cluster.depth);
+            if (representative == UINT32_MAX || distance < best) {
+                representative = id;
+                best = distance;
+            }
+            node_cluster[id] = index;
+        }
+        for (uint32_t k = 0; k < span; k++) {
+            if (graph.nodes[ids[k]].visible) display_id[ids[k]] = representative;
+        }
+        node_in_view[representative] = 1;
+        node_clusters.push_back(cluster);
+        frame_stats.nodes_clustered += cluster.members;
+        return true;
+    };
+
+    node_in_view.assign(count, 0);
+    node_cluster.assign(count, -1);
+    display_id.resize(count);
+    for (uint32_t i = 0; i < count; i++) display_id[i] = i;
+    node_clusters.clear();
+    frame_stats.nodes_clustered = 0;
+    // Density splats draw every node, and bundled polylines run between real
+    // node positions, so impostors would only leave edges ending in mid-air
+    if (lod_enabled && !density_mode && !edge_bundling) {
+        node_bvh.query(classify, emit, collapse);
+    } else {
+        node_bvh.query(classify, emit);
+    }
+
+    // Where each node's edges attach: its own position, or its cluster's impostor
+    size_t known_nodes = std::min<size_t>(last_display_id.size(), count);
+    display_pos.resize(count);
+    display_changed.assign(count, 1);
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t c = node_cluster[i];
+        display_pos[i] = c >= 0 ? node_clusters[c].screen : sf::Vector2f(projected.x[i], projected.y[i]);
+        if (i < known_nodes) display_changed[i] = display_id[i] != last_display_id[i] || display_pos[i] != last_display_pos[i];
+    }
+    last_display_id = display_id;
+    last_display_pos = display_pos;
+}
 
-    // Add view_center offset to restore mouse panning functionality (invert for correct direction)
-    float screen_x = window_size.x / 2.0f + final_x * zoom_scale - view_center.x;
-    float screen_y = window_size.y / 2.0f - final_y * zoom_scale - view_center.y;
+void GraphRenderer::update_node_draw_order(const Graph3D& graph) {
+    size_t count = graph.node_count;
+    const std::vector<float>& depth = projected.depth;
 
-    return sf::Vector2f(screen_x, screen_y);
+    // A changed visible set invalidates the order outright
+    bool same_nodes = draw_order_visible.size() == count;
+    for (size_t i = 0; same_nodes && i < count; i++) {
+        same_nodes = draw_order_visible[i] == static_cast<uint8_t>(graph.nodes[i].visible);
+    }
+
+    if (same_nodes) {
+        // Neither camera nor positions changed: the order from last frame stands
+        if (depth == draw_order_depths) return;
+        draw_order_depths = depth;
+
+        // Coherent frame: last frame's order is nearly sorted, so insertion sort
+        // repairs it in about O(N + moves); give up once the moves exceed a budget
+        size_t budget = 4 * node_draw_order.size() + 64;
+        size_t moves = 0;
+        for (size_t i = 1; i < node_draw_order.size() && moves <= budget; i++) {
+            uint32_t id = node_draw_order[i];
+            size_t j = i;
+            for (; j > 0 && depth[node_draw_order[j - 1]] < depth[id]; j--) node_draw_order[j] = node_draw_order[j - 1];
+            node_draw_order[j] = id;
+            moves += i - j;
+        }
+        if (moves <= budget) return;
+    } else {
+        draw_order_visible.resize(count);
+        node_draw_order.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            draw_order_visible[i] = graph.nodes[i].visible;
+            if (graph.nodes[i].visible) node_draw_order.push_back(i);
+        }
+        draw_order_depths = depth;
+    }
+
+    // Full re-sort: two 8-bit LSD radix passes over depth quantised to 16 bits,
+    // inverted so the farthest node comes first. Stable, so near-ties keep their
+    // previous relative order and don't flicker.
+    if (node_draw_order.size() < 2) return;
+    float min_depth = depth[node_draw_order[0]];
+    float max_depth = min_depth;
+    for (uint32_t id : node_draw_order) {
+        min_depth = std::min(min_depth, depth[id]);
+        max_depth = std::max(max_depth, depth[id]);
+    }
+    float key_scale = max_depth > min_depth ? 65535.0f / (max_depth - min_depth) : 0.0f;
+
+    draw_order_keys.resize(count);
+    for (uint32_t id : node_draw_order) {
+        draw_order_keys[id] = static_cast<uint16_t>(65535 - static_cast<int>((depth[id] - min_depth) * key_scale));
+    }
+
+    draw_order_scratch.resize(node_draw_order.size());
+    for (int shift = 0; shift < 16; shift += 8) {
+        size_t offsets[257] = {0};
+        for (uint32_t id : node_draw_order) offsets[((draw_order_keys[id] >> shift) & 0xff) + 1]++;
+        for (int b = 0; b < 256; b++) offsets[b + 1] += offsets[b];
+        for (uint32_t id : node_draw_order) draw_order_scratch[offsets[(draw_order_keys[id] >> shift) & 0xff]++] = id;
+        node_draw_order.swap(draw_order_scratch);
+    }
 }
 
 float GraphRenderer::apply_perspective(float z_depth) {
@@ -664,28 +962,35 @@ sf::Color GraphRenderer::apply_lighting(const Vector3& /* position */, const Vec
 
 sf::Color GraphRenderer::apply_fog(const sf::Color& color, float depth) {
     if (lighting.fog_density <= 0) return color;
+    return apply_fog_factor(color, fog_factor(depth));
+}
+
+float GraphRenderer::fog_factor(float depth) const {
+    if (lighting.fog_density <= 0) return 0.0f;
 
     // Calculate fog factor based on depth
-    float fog_factor = 0.0f;
+    float factor = 0.0f;
     if (depth < lighting.fog_start) {
-        fog_factor = 0.0f;
+        factor = 0.0f;
     } else if (depth > lighting.fog_end) {
-        fog_factor = 1.0f;
+        factor = 1.0f;
     } else {
-        fog_factor = (depth - lighting.fog_start) / (lighting.fog_end - lighting.fog_start);
-        fog_factor = std::pow(fog_factor, 2.0f); // Quadratic fog
+        factor = (depth - lighting.fog_start) / (lighting.fog_end - lighting.fog_start);
+        factor = factor * factor; // Quadratic fog
     }
 
-    fog_factor *= lighting.fog_density;
-    fog_factor = std::min(1.0f, fog_factor);
+    factor *= lighting.fog_density;
+    return std::min(1.0f, factor);
+}
 
+sf::Color GraphRenderer::apply_fog_factor(const sf::Color& color, float fog) const {
     // Fog color (slightly bluish-gray)
     sf::Color fog_color(100, 110, 120);
 
     return sf::Color(
-        color.r * (1 - fog_factor) + fog_color.r * fog_factor,
-        color.g * (1 - fog_factor) + fog_color.g * fog_factor,
-        color.b * (1 - fog_factor) + fog_color.b * fog_factor,
+        color.r * (1 - fog) + fog_color.r * fog,
+        color.g * (1 - fog) + fog_color.g * fog,
+        color.b * (1 - fog) + fog_color.b * fog,
         color.a
     );
 }
@@ -699,6 +1004,317 @@ float GraphRenderer::calculate_depth_shade(float depth) {
     return 1.0f - normalized_depth * 0.5f;
 }
 
+// Edge colour at a midpoint and depth; bundles of several edges draw brighter
+sf::Color GraphRenderer::shade_edge_color(const Vector3& edge_center, float depth, uint32_t bundle) {
+    // Base edge color with transparency based on depth
+    sf::Color edge_color(130, 130, 180, 170);
+    if (bundle > 1) {
+        float boost = 1.0f + 0.25f * std::log2(static_cast<float>(bundle));
+        edge_color = sf::Color(static_cast<uint8_t>(std::min(255.0f, 130 * boost)),
+                               static_cast<uint8_t>(std::min(255.0f, 130 * boost)),
+                               static_cast<uint8_t>(std::min(255.0f, 180 * boost)),
+                               static_cast<uint8_t>(std::min(255.0f, 170 * boost)));
+    }
+
+    // Apply depth and subtle contour shading to edges based on midpoint height
+    float shade = calculate_depth_shade(depth);
+    edge_color.r *= shade;
+    edge_color.g *= shade;
+    edge_color.b *= shade;
+    float mid_height = edge_center.y - scene_center.y;
+    float band_e = 0.5f + 0.5f * std::sin(mid_height * lighting.contour_frequency + lighting.contour_offset);
+    float contour_mix_e = 1.0f - (lighting.contour_intensity * 0.5f) + (lighting.contour_intensity * 0.5f) * band_e;
+    edge_color.r = static_cast<unsigned char>(std::min(255.0f, edge_color.r * contour_mix_e));
+    edge_color.g = static_cast<unsigned char>(std::min(255.0f, edge_color.g * contour_mix_e));
+    edge_color.b = static_cast<unsigned char>(std::min(255.0f, edge_color.b * contour_mix_e));
+
+    // Apply fog
+    edge_color = apply_fog(edge_color, depth);
+    return edge_color;
+}
+
+void GraphRenderer::draw_edges(const Graph3D& graph) {
+    // Everything edge vertices depend on besides node positions; any change rebuilds every slot
+    const float (&m)[3][4] = camera_transform.rows;
+    std::array<float, 21> view_state = {
+        m[0][0], m[0][1], m[0][2], m[0][3], m[1][0], m[1][1], m[1][2], m[1][3], m[2][0], m[2][1], m[2][2], m[2][3],
+        scene_center.x, scene_center.y, scene_center.z,
+        lighting.contour_intensity, lighting.contour_frequency, lighting.contour_offset,
+        lighting.fog_density, lighting.fog_start, lighting.fog_end};
+    bool rebuild_all = view_state != edge_view_state;
+    edge_view_state = view_state;
+
+    size_t vertex_count = static_cast<size_t>(graph.edge_count) * 2;
+    bool use_buffer = sf::VertexBuffer::isAvailable();
+    bool reupload_all = false;
+    if (use_buffer && edge_buffer.getVertexCount() < vertex_count) {
+        // Grow geometrically; a new buffer starts empty, so every slot goes up again
+        if (!edge_buffer.create(std::max(vertex_count, edge_buffer.getVertexCount() * 2))) use_buffer = false;
+        reupload_all = true;
+    }
+    edge_vertices.resize(vertex_count);
+    edge_slot_keys.resize(graph.edge_count, UINT64_MAX);
+    edge_slot_culled.resize(graph.edge_count, 0);
+    edge_slot_bundle.resize(graph.edge_count, 1);
+    sf::Vector2u window_size = window.getSize();
+
+    // Edges inside a cluster vanish into its impostor; edges between the same
+    // pair of attachment points (at least one an impostor) draw as one bundle
+    // line led by the lowest slot, brighter with the number of edges it carries
+    edge_bundle_size.assign(graph.edge_count, 1);
+    if (!node_clusters.empty()) {
+        edge_bundle_leaders.clear();
+        for (uint32_t i = 0; i < graph.edge_count; i++) {
+            const GraphEdge& edge = graph.edges[i];
+            if (!edge.visible) continue;
+            uint32_t a = display_id[edge.from_id], b = display_id[edge.to_id];
+            if (a == edge.from_id && b == edge.to_id) continue;
+            if (a == b) {
+                edge_bundle_size[i] = 0;
+                continue;
+            }
+            uint64_t pair = static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+            auto inserted = edge_bundle_leaders.emplace(pair, i);
+            if (!inserted.second) {
+                edge_bundle_size[inserted.first->second]++;
+                edge_bundle_size[i] = 0;
+            }
+        }
+    }
+
+    // Rebuild stale slots, collecting the runs of vertices that actually changed
+    std::vector<std::pair<size_t, size_t>> dirty_runs; // [first, last] edge slots
+    const size_t merge_gap = 32; // nearby runs go up as one upload
+    for (uint32_t i = 0; i < graph.edge_count; i++) {
+        const GraphEdge& edge = graph.edges[i];
+        uint64_t slot_key = edge.visible ? (static_cast<uint64_t>(edge.from_id) << 32 | edge.to_id) : UINT64_MAX - 1;
+        bool stale = rebuild_all || edge_slot_keys[i] != slot_key ||
+                     edge_slot_bundle[i] != edge_bundle_size[i] ||
+                     (edge.visible && (node_moved[edge.from_id] || node_moved[edge.to_id] ||
+                                       display_changed[edge.from_id] || display_changed[edge.to_id]));
+        if (!stale && !reupload_all) continue;
+        edge_slot_keys[i] = slot_key;
+        edge_slot_bundle[i] = edge_bundle_size[i];
+        uint32_t bundle = edge_bundle_size[i];
+        uint32_t from_id = display_id[edge.from_id], to_id = display_id[edge.to_id];
+        sf::Vector2f from_pos = display_pos[edge.from_id], to_pos = display_pos[edge.to_id];
+
+        // Cull edges whose screen bounds miss the window or that are under a pixel long
+        bool culled = false;
+        if (edge.visible && bundle > 0) {
+            float x0 = from_pos.x, y0 = from_pos.y;
+            float x1 = to_pos.x, y1 = to_pos.y;
+            culled = std::max(x0, x1) < 0.0f || std::min(x0, x1) > window_size.x ||
+                     std::max(y0, y1) < 0.0f || std::min(y0, y1) > window_size.y ||
+                     (std::abs(x1 - x0) < 1.0f && std::abs(y1 - y0) < 1.0f);
+        }
+        edge_slot_culled[i] = culled;
+
+        sf::Vertex v1, v2;
+        if (edge.visible && bundle > 0 && !culled) {
+            const GraphNode& from_node = graph.nodes[from_id];
+            const GraphNode& to_node = graph.nodes[to_id];
+
+            // Depth is affine, so the midpoint's depth for fog is the endpoints' average
+            Vector3 edge_center = (from_node.position + to_node.position) * 0.5f;
+            float depth = 0.5f * (projected.depth[from_id] + projected.depth[to_id]);
+
+            sf::Color edge_color = shade_edge_color(edge_center, depth, bundle);
+
+            v1.position = from_pos;
+            v1.color = edge_color;
+            v2.position = to_pos;
+            v2.color = edge_color;
+        } else {
+            // Hidden, bundled and culled edges keep their slot as a transparent zero-length line
+            v1.color = v2.color = sf::Color::Transparent;
+        }
+
+        // Sub-pixel motion is invisible: keep what the buffer already has
+        sf::Vertex& old1 = edge_vertices[2 * i];
+        sf::Vertex& old2 = edge_vertices[2 * i + 1];
+        bool unchanged = std::abs(old1.position.x - v1.position.x) <= 1.0f && std::abs(old1.position.y - v1.position.y) <= 1.0f &&
+                         std::abs(old2.position.x - v2.position.x) <= 1.0f && std::abs(old2.position.y - v2.position.y) <= 1.0f &&
+                         old1.color == v1.color;
+        if (unchanged && !reupload_all) continue;
+        old1 = v1;
+        old2 = v2;
+
+        if (!dirty_runs.empty() && i <= dirty_runs.back().second + merge_gap) {
+            dirty_runs.back().second = i;
+        } else {
+            dirty_runs.emplace_back(i, i);
+        }
+    }
+
+    frame_stats.edges_drawn = 0;
+    frame_stats.edges_culled = 0;
+    frame_stats.edges_bundled = 0;
+    for (uint32_t i = 0; i < graph.edge_count; i++) {
+        if (!graph.edges[i].visible) continue;
+        if (edge_slot_bundle[i] == 0) frame_stats.edges_bundled++;
+        else if (edge_slot_culled[i]) frame_stats.edges_culled++;
+        else frame_stats.edges_drawn++;
+    }
+
+    if (vertex_count == 0) return;
+    if (!use_buffer) {
+        window.draw(edge_vertices.data(), vertex_count, sf::PrimitiveType::Lines);
+        return;
+    }
+    for (const auto& run : dirty_runs) {
+        size_t first = run.first * 2;
+        edge_buffer.update(&edge_vertices[first], (run.second - run.first + 1) * 2, static_cast<unsigned int>(first));
+    }
+    window.draw(edge_buffer, 0, vertex_count);
+}
+
+void GraphRenderer::refresh_edge_bundles(const Graph3D& graph) {
+    // Swap in a finished job; slots rebuild against its offsets
+    if (edge_bundle_job.valid() &&
+        edge_bundle_job.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        edge_bundles = edge_bundle_job.get();
+        edge_bundles_fresh = true;
+        edge_bundle_age.restart();
+    }
+
+    std::vector<uint64_t> keys(graph.edge_count);
+    for (uint32_t i = 0; i < graph.edge_count; i++) {
+        const GraphEdge& edge = graph.edges[i];
+        keys[i] = edge.visible ? (static_cast<uint64_t>(edge.from_id) << 32 | edge.to_id) : UINT64_MAX;
+    }
+    if (any_node_moved || keys != edge_bundle_job_keys) {
+        edge_bundles_stale = true;
+        edge_bundle_settle.restart();
+    }
+
+    // One job in flight at a time, continuing from the current polylines. It
+    // waits for the layout to hold still for a moment, or for the last result
+    // to age out, so a layout that never quite stops leaves the core idle most
+    // of the time instead of rebundling back to back
+    bool settled = edge_bundle_settle.getElapsedTime().asSeconds() >= edge_bundle_settle_seconds;
+    bool aged = edge_bundle_age.getElapsedTime().asSeconds() >= edge_bundle_max_age_seconds;
+    if (edge_bundles_stale && !edge_bundle_job.valid() && (settled || aged)) {
+        edge_bundles_stale = false;
+        std::vector<Vector3> positions(graph.node_count);
+        for (uint32_t i = 0; i < graph.node_count; i++) positions[i] = graph.nodes[i].position;
+        edge_bundle_job_keys = keys;
+        edge_bundle_job = std::async(std::launch::async, [positions = std::move(positions), keys = std::move(keys),
+                                                          previous = edge_bundles]() {
+            return EdgeBundler::bundle(positions, keys, EdgeBundler::BundlingParams(), &previous);
+        });
+    }
+}
+
+void GraphRenderer::draw_bundled_edges(const Graph3D& graph) {
+    const float (&m)[3][4] = camera_transform.rows;
+    std::array<float, 21> view_state = {
+        m[0][0], m[0][1], m[0][2], m[0][3], m[1][0], m[1][1], m[1][2], m[1][3], m[2][0], m[2][1], m[2][2], m[2][3],
+        scene_center.x, scene_center.y, scene_center.z,
+        lighting.contour_intensity, lighting.contour_frequency, lighting.contour_offset,
+        lighting.fog_density, lighting.fog_start, lighting.fog_end};
+    bool rebuild_all = view_state != bundle_view_state || edge_bundles_fresh;
+    bundle_view_state = view_state;
+    edge_bundles_fresh = false;
+
+    uint32_t points = edge_bundles.points;
+    size_t slot_vertices = 2 * (static_cast<size_t>(points) + 1);
+    size_t vertex_count = graph.edge_count * slot_vertices;
+    bool use_buffer = sf::VertexBuffer::isAvailable();
+    bool reupload_all = false;
+    if (use_buffer && bundle_buffer.getVertexCount() < vertex_count) {
+        if (!bundle_buffer.create(std::max(vertex_count, bundle_buffer.getVertexCount() * 2))) use_buffer = false;
+        reupload_all = true;
+    }
+    if (bundle_vertices.size() != vertex_count) {
+        bundle_vertices.resize(vertex_count);
+        rebuild_all = true; // slot layout changed with the number of points
+    }
+    bundle_slot_keys.resize(graph.edge_count, UINT64_MAX);
+    bundle_slot_culled.resize(graph.edge_count, 0);
+    sf::Vector2u window_size = window.getSize();
+
+    std::vector<sf::Vector2f> polyline(points + 2);
+    std::vector<std::pair<size_t, size_t>> dirty_runs; // [first, last] edge slots
+    const size_t merge_gap = 8;
+    for (uint32_t i = 0; i < graph.edge_count; i++) {
+        const GraphEdge& edge = graph.edges[i];
+        uint64_t edge_key = static_cast<uint64_t>(edge.from_id) << 32 | edge.to_id;
+        uint64_t slot_key = edge.visible ? edge_key : UINT64_MAX - 1;
+        bool stale = rebuild_all || bundle_slot_keys[i] != slot_key ||
+                     (edge.visible && (node_moved[edge.from_id] || node_moved[edge.to_id]));
+        if (!stale && !reupload_all) continue;
+        bundle_slot_keys[i] = slot_key;
+
+        // Straight line plus the bundled offsets, if the result covers this edge
+        bool culled = false;
+        sf::Vertex* out = &bundle_vertices[i * slot_vertices];
+        if (edge.visible) {
+            const Vector3& start = graph.nodes[edge.from_id].position;
+            const Vector3& end = graph.nodes[edge.to_id].position;
+            bool bundled = i < edge_bundles.keys.size() && edge_bundles.keys[i] == edge_key;
+            float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+            for (uint32_t k = 0; k < points + 2; k++) {
+                float t = static_cast<float>(k) / (points + 1);
+                Vector3 p = start + (end - start) * t;
+                if (bundled && k > 0 && k <= points) p = p + edge_bundles.offsets[static_cast<size_t>(i) * points + k - 1];
+                polyline[k] = sf::Vector2f(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                                           m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3]);
+                min_x = std::min(min_x, polyline[k].x);
+                max_x = std::max(max_x, polyline[k].x);
+                min_y = std::min(min_y, polyline[k].y);
+                max_y = std::max(max_y, polyline[k].y);
+            }
+            culled = max_x < 0.0f || min_x > window_size.x || max_y < 0.0f || min_y > window_size.y ||
+                     (max_x - min_x < 1.0f && max_y - min_y < 1.0f);
+        }
+        bundle_slot_culled[i] = culled;
+
+        if (edge.visible && !culled) {
+            Vector3 edge_center = (graph.nodes[edge.from_id].position + graph.nodes[edge.to_id].position) * 0.5f;
+            float depth = 0.5f * (projected.depth[edge.from_id] + projected.depth[edge.to_id]);
+            sf::Color edge_color = shade_edge_color(edge_center, depth, 1);
+            for (uint32_t k = 0; k <= points; k++) {
+                out[2 * k].position = polyline[k];
+                out[2 * k + 1].position = polyline[k + 1];
+                out[2 * k].color = out[2 * k + 1].color = edge_color;
+            }
+        } else {
+            // Hidden and culled edges keep their slot as transparent zero-length lines
+            for (size_t k = 0; k < slot_vertices; k++) {
+                out[k].position = sf::Vector2f();
+                out[k].color = sf::Color::Transparent;
+            }
+        }
+
+        if (!dirty_runs.empty() && i <= dirty_runs.back().second + merge_gap) {
+            dirty_runs.back().second = i;
+        } else {
+            dirty_runs.emplace_back(i, i);
+        }
+    }
+
+    frame_stats.edges_drawn = 0;
+    frame_stats.edges_culled = 0;
+    frame_stats.edges_bundled = 0;
+    for (uint32_t i = 0; i < graph.edge_count; i++) {
+        if (!graph.edges[i].visible) continue;
+        if (bundle_slot_culled[i]) frame_stats.edges_culled++;
+        else frame_stats.edges_drawn++;
+    }
+
+    if (vertex_count == 0) return;
+    if (!use_buffer) {
+        window.draw(bundle_vertices.data(), vertex_count, sf::PrimitiveType::Lines);
+        return;
+    }
+    for (const auto& run : dirty_runs) {
+        size_t first = run.first * slot_vertices;
+        bundle_buffer.update(&bundle_vertices[first], (run.second - run.first + 1) * slot_vertices, static_cast<unsigned int>(first));
+    }
+    window.draw(bundle_buffer, 0, vertex_count);
+}
+
 void GraphRenderer::save_camera_preset(int slot) {
     if (slot < 0 || slot >= 10) return;
 
@@ -740,6 +1356,7 @@ void GraphRenderer::adjust_lighting(float ambient_delta, float directional_delta
     if (directional_delta != 0) {
         std::cout << "Directional light: " << (int)(lighting.directional_intensity * 100) << "%" << std::endl;
     }
+    sphere_atlas_stale = true;
 }
 
 void GraphRenderer::rotate_light(float horizontal, float vertical) {
@@ -758,6 +1375,7 @@ void GraphRenderer::rotate_light(float horizontal, float vertical) {
     lighting.directional_light_dir.x = length * std::sin(phi) * std::cos(theta);
     lighting.directional_light_dir.y = length * std::cos(phi);
     lighting.directional_light_dir.z = length * std::sin(phi) * std::sin(theta);
+    sphere_atlas_stale = true;
 }
 
 void GraphRenderer::reset_camera() {
@@ -915,6 +1533,7 @@ void GraphRenderer::draw_help_overlay_sfml() {
 
     addText("Visuals", 30.f, y, 22, sf::Color(200,220,255)); y += 28.f;
     addText("F: Fog, G: Grid, X: Axes, O: Info overlay, H: Toggle this help", 40.f, y, 18, sf::Color(230,230,240)); y += 28.f;
+    addText("C: Cluster LOD, M: Density splats, B: Edge bundling", 40.f, y, 18, sf::Color(230,230,240)); y += 22.f;
     addText("Space: Auto-rotate, P: Physics", 40.f, y, 18, sf::Color(230,230,240));
 }
 
@@ -965,108 +1584,83 @@ void GraphRenderer::render_frame(const Graph3D& graph, const Pixels& overlay) {
     draw_grid();
     draw_axes();
 
-    // Precompute camera forward direction for depth calculations
-    Vector3 forward_dir = (scale_for_render(camera_target) - scale_for_render(camera_position)).normalize();
-
-    // Draw edges with 3D perspective and lighting
-    std::vector<sf::Vertex> edge_vertices;
+    // Screen position and depth of every node, shared by edges and nodes
+    project_nodes(graph);
+    cull_nodes(graph);
 
-    for (uint32_t i = 0; i < graph.edge_count; i++) {
-        const GraphEdge& edge = graph.edges[i];
-        if (!edge.visible) continue;
-
-        const GraphNode& from_node = graph.nodes[edge.from_id];
-        const GraphNode& to_node = graph.nodes[edge.to_id];
-
-        sf::Vector2f from_pos = world_to_screen_3d(from_node.position);
-        sf::Vector2f to_pos = world_to_screen_3d(to_node.position);
-
-        // Calculate depth for fog
-        Vector3 edge_center = (from_node.position + to_node.position) * 0.5f;
-        Vector3 relative_pos = scale_for_render(edge_center) - scale_for_render(camera_position);
-        float depth = relative_pos.x * forward_dir.x + relative_pos.y * forward_dir.y + relative_pos.z * forward_dir.z;
-
-        // Base edge color with transparency based on depth
-        sf::Color edge_color(130, 130, 180, 170);
-
-        // Apply depth and subtle contour shading to edges based on midpoint height
-        float shade = calculate_depth_shade(depth);
-        edge_color.r *= shade;
-        edge_color.g *= shade;
-        edge_color.b *= shade;
-        float mid_height = edge_center.y - scene_center.y;
-        float band_e = 0.5f + 0.5f * std::sin(mid_height * lighting.contour_frequency + lighting.contour_offset);
-        float contour_mix_e = 1.0f - (lighting.contour_intensity * 0.5f) + (lighting.contour_intensity * 0.5f) * band_e;
-        edge_color.r = static_cast<unsigned char>(std::min(255.0f, edge_color.r * contour_mix_e));
-        edge_color.g = static_cast<unsigned char>(std::min(255.0f, edge_color.g * contour_mix_e));
-        edge_color.b = static_cast<unsigned char>(std::min(255.0f, edge_color.b * contour_mix_e));
-
-        // Apply fog
-        edge_color = apply_fog(edge_color, depth);
-
-        // Create edge vertices
-        sf::Vertex v1, v2;
-        v1.position = from_pos;
-        v1.color = edge_color;
-        v2.position = to_pos;
-        v2.color = edge_color;
-        edge_vertices.push_back(v1);
-        edge_vertices.push_back(v2);
+    // Draw edges with 3D perspective and lighting, straight or bundled; the pass
+    // that sat out last frame missed node moves, so it rebuilds every slot
+    if (edge_bundling != edge_pass_bundled) {
+        edge_pass_bundled = edge_bundling;
+        edge_slot_keys.clear();
+        bundle_slot_keys.clear();
     }
-
-    if (!edge_vertices.empty()) {
-        window.draw(edge_vertices.data(), edge_vertices.size(), sf::PrimitiveType::Lines);
+    if (edge_bundling) {
+        refresh_edge_bundles(graph);
+        draw_bundled_edges(graph);
+    } else {
+        draw_edges(graph);
     }
 
-    // Build draw order for nodes: sort by depth (far to near) to emulate z-buffer
-    std::vector<uint32_t> node_indices;
-    node_indices.reserve(graph.node_count);
-    for (uint32_t i = 0; i < graph.node_count; i++) {
-        if (graph.nodes[i].visible) node_indices.push_back(i);
-    }
-    std::sort(node_indices.begin(), node_indices.end(), [&](uint32_t a, uint32_t b) {
-        const Vector3& pa = graph.nodes[a].position;
-        const Vector3& pb = graph.nodes[b].position;
-        Vector3 ra = pa - camera_position;
-        Vector3 rb = pb - camera_position;
-        float da = ra.x * forward_dir.x + ra.y * forward_dir.y + ra.z * forward_dir.z;
-        float db = rb.x * forward_dir.x + rb.y * forward_dir.y + rb.z * forward_dir.z;
-        return da > db; // draw far first
-    });
-
-    // Draw nodes with 3D perspective, lighting, and depth-based sizing
-    for (uint32_t idx : node_indices) {
-        const GraphNode& node = graph.nodes[idx];
-        sf::Vector2f screen_pos = world_to_screen_3d(node.position);
-
-        // Calculate depth for perspective scaling
-        Vector3 relative_pos = scale_for_render(node.position) - scale_for_render(camera_position);
-        float depth = relative_pos.x * forward_dir.x + relative_pos.y * forward_dir.y + relative_pos.z * forward_dir.z;
-
-        float perspective_scale = apply_perspective(depth);
-        float visual_radius = node.radius * perspective_scale * 0.5f;
-        visual_radius = std::max(2.0f, std::min(visual_radius, 50.0f));
-
-        // Calculate node normal relative to scene center (world-relative lighting)
-        Vector3 normal = (node.position - scene_center).normalize();
-
-        // Apply lighting to node color
-        sf::Color lit_color = apply_lighting(node.position, normal,
-            sf::Color(node.color.r, node.color.g, node.color.b, node.color.a));
-
-        // Add contour banding based on world-space height relative to scene center
-        float height = node.position.y - scene_center.y;
-        float band = 0.5f + 0.5f * std::sin(height * lighting.contour_frequency + lighting.contour_offset);
-        float contour_mix = 1.0f - lighting.contour_intensity + lighting.contour_intensity * band;
-        lit_color.r = static_cast<unsigned char>(std::min(255.0f, lit_color.r * contour_mix));
-        lit_color.g = static_cast<unsigned char>(std::min(255.0f, lit_color.g * contour_mix));
-        lit_color.b = static_cast<unsigned char>(std::min(255.0f, lit_color.b * contour_mix));
-
-        // Apply fog based on depth
-        lit_color = apply_fog(lit_color, depth);
-
-        // Create textured node with lighting response
-        draw_textured_node(window, screen_pos, visual_radius, lit_color, depth, node.position);
+    // Density mode replaces the sphere pass with one splatted texture
+    if (density_mode) {
+        draw_density(graph);
+    } else {
+        // Draw order for nodes: by depth (far to near) to emulate z-buffer
+        update_node_draw_order(graph);
+
+        // Draw nodes with 3D perspective, lighting, and depth-based sizing, batched
+        // back to front into one vertex array so the whole set is a single draw call
+        refresh_sphere_atlas();
+        node_vertices.clear();
+        node_vertices.reserve(node_draw_order.size() * 12);
+        frame_stats.nodes_drawn = 0;
+        frame_stats.nodes_culled = 0;
+        frame_stats.clusters_drawn = 0;
+        for (uint32_t idx : node_draw_order) {
+            if (!node_in_view[idx]) {
+                if (node_cluster[idx] < 0) frame_stats.nodes_culled++;
+                continue;
+            }
+            if (node_cluster[idx] >= 0) {
+                // Cluster impostor, lit and fogged like a node at the members' centroid
+                const NodeCluster& cluster = node_clusters[node_cluster[idx]];
+                Vector3 normal = (cluster.centroid - scene_center).normalize();
+                sf::Color lit_color = apply_lighting(cluster.centroid, normal, cluster.color);
+                lit_color = apply_fog(lit_color, cluster.depth);
+                append_node_quads(node_vertices, cluster.screen, cluster.radius, lit_color, cluster.depth);
+                frame_stats.clusters_drawn++;
+                continue;
+            }
+            frame_stats.nodes_drawn++;
+            const GraphNode& node = graph.nodes[idx];
+            sf::Vector2f screen_pos(projected.x[idx], projected.y[idx]);
+            float depth = projected.depth[idx];
+
+            // Calculate node normal relative to scene center (world-relative lighting)
+            Vector3 normal = (node.position - scene_center).normalize();
+
+            // Apply lighting to node color
+            sf::Color lit_color = apply_lighting(node.position, normal,
+                sf::Color(node.color.r, node.color.g, node.color.b, node.color.a));
+
+            // Add contour banding based on world-space height relative to scene center
+            float height = node.position.y - scene_center.y;
+            float band = 0.5f + 0.5f * std::sin(height * lighting.contour_frequency + lighting.contour_offset);
+            float contour_mix = 1.0f - lighting.contour_intensity + lighting.contour_intensity * band;
+            lit_color.r = static_cast<unsigned char>(std::min(255.0f, lit_color.r * contour_mix));
+            lit_color.g = static_cast<unsigned char>(std::min(255.0f, lit_color.g * contour_mix));
+            lit_color.b = static_cast<unsigned char>(std::min(255.0f, lit_color.b * contour_mix));
+
+            // Apply fog based on depth
+            lit_color = apply_fog_factor(lit_color, projected.fog[idx]);
+
+            // Textured node with lighting response
+            append_node_quads(node_vertices, screen_pos, projected.radius[idx], lit_color, depth);
+        }
+        if (!node_vertices.empty() && sphere_atlas) {
+            window.draw(node_vertices.data(), node_vertices.size(), sf::PrimitiveType::Triangles, sf::RenderStates(sphere_atlas));
+        }
     }
 
     // Draw custom overlay if provided (and help is not shown)
@@ -1088,6 +1682,7 @@ void GraphRenderer::render_frame(const Graph3D& graph, const Pixels& overlay) {
 
     // Draw interactive UI (sliders)
     draw_ui_sliders();
+    draw_frame_stats();
 
     // Draw help overlay last so it sits above sliders
     if (show_help) {
@@ -1100,6 +1695,123 @@ void GraphRenderer::render_frame(const Graph3D& graph, const Pixels& overlay) {
     window.display();
 }
 
+void GraphRenderer::draw_density(const Graph3D& graph) {
+    sf::Vector2u size = window.getSize();
+    if (size.x == 0 || size.y == 0) return;
+    size_t pixel_count = static_cast<size_t>(size.x) * size.y;
+    if (size != density_size || !density_texture) {
+        density_size = size;
+        density_grid.assign(pixel_count * 4, 0.0f);
+        density_pixels.assign(pixel_count * 4, 0);
+        if (!density_texture) density_texture = new sf::Texture();
+        if (!density_texture->resize(size)) {
+            std::cerr << "Failed to create density texture" << std::endl;
+            delete density_texture;
+            density_texture = nullptr;
+            return;
+        }
+    }
+
+    // Bin nodes by the bands their 2x2 splat footprint touches, so each worker
+    // owns its rows outright and no two threads add into the same pixel
+    unsigned band_count = std::max(1u, std::min(std::thread::hardware_concurrency(), size.y));
+    unsigned band_rows = (size.y + band_count - 1) / band_count;
+    auto footprint = [&](uint32_t i, int& x0, int& y0) {
+        x0 = static_cast<int>(std::floor(projected.x[i] - 0.5f));
+        y0 = static_cast<int>(std::floor(projected.y[i] - 0.5f));
+        return graph.nodes[i].visible && x0 >= -1 && x0 < static_cast<int>(size.x) &&
+               y0 >= -1 && y0 < static_cast<int>(size.y);
+    };
+    auto for_each_band = [&](int y0, auto&& fn) {
+        unsigned first = static_cast<unsigned>(std::max(y0, 0)) / band_rows;
+        unsigned last = static_cast<unsigned>(std::min(y0 + 1, static_cast<int>(size.y) - 1)) / band_rows;
+        fn(first);
+        if (last != first) fn(last);
+    };
+
+    density_band_start.assign(band_count + 1, 0);
+    frame_stats.nodes_drawn = 0;
+    frame_stats.nodes_culled = 0;
+    frame_stats.clusters_drawn = 0;
+    for (uint32_t i = 0; i < graph.node_count; i++) {
+        int x0, y0;
+        if (!footprint(i, x0, y0)) {
+            if (graph.nodes[i].visible) frame_stats.nodes_culled++;
+            continue;
+        }
+        frame_stats.nodes_drawn++;
+        for_each_band(y0, [&](unsigned band) { density_band_start[band + 1]++; });
+    }
+    for (unsigned band = 0; band < band_count; band++) density_band_start[band + 1] += density_band_start[band];
+    density_band_nodes.resize(density_band_start[band_count]);
+    std::vector<uint32_t> cursor(density_band_start.begin(), density_band_start.end() - 1);
+    for (uint32_t i = 0; i < graph.node_count; i++) {
+        int x0, y0;
+        if (!footprint(i, x0, y0)) continue;
+        for_each_band(y0, [&](unsigned band) { density_band_nodes[cursor[band]++] = i; });
+    }
+
+    // Each band: clear, splat its nodes (fogged colour, bilinear weights), tone map
+    auto splat_band = [&](unsigned band) {
+        int row_begin = static_cast<int>(band * band_rows);
+        int row_end = std::min(row_begin + static_cast<int>(band_rows), static_cast<int>(size.y));
+        if (row_begin >= row_end) return;
+        float* grid = density_grid.data();
+        std::fill(grid + static_cast<size_t>(row_begin) * size.x * 4, grid + static_cast<size_t>(row_end) * size.x * 4, 0.0f);
+
+        for (uint32_t k = density_band_start[band]; k < density_band_start[band + 1]; k++) {
+            uint32_t i = density_band_nodes[k];
+            const Color& base = graph.nodes[i].color;
+            sf::Color color = apply_fog_factor(sf::Color(base.r, base.g, base.b, base.a), projected.fog[i]);
+            float fx = projected.x[i] - 0.5f, fy = projected.y[i] - 0.5f;
+            int x0 = static_cast<int>(std::floor(fx)), y0 = static_cast<int>(std::floor(fy));
+            float wx = fx - x0, wy = fy - y0;
+            for (int dy = 0; dy < 2; dy++) {
+                int y = y0 + dy;
+                if (y < row_begin || y >= row_end) continue;
+                float row_weight = dy ? wy : 1.0f - wy;
+                for (int dx = 0; dx < 2; dx++) {
+                    int x = x0 + dx;
+                    if (x < 0 || x >= static_cast<int>(size.x)) continue;
+                    float w = row_weight * (dx ? wx : 1.0f - wx);
+                    float* cell = grid + (static_cast<size_t>(y) * size.x + x) * 4;
+                    cell[0] += w * color.r;
+                    cell[1] += w * color.g;
+                    cell[2] += w * color.b;
+                    cell[3] += w;
+                }
+            }
+        }
+
+        // Mean colour per pixel; coverage saturates exponentially with density
+        const float* cell = grid + static_cast<size_t>(row_begin) * size.x * 4;
+        uint8_t* out = density_pixels.data() + static_cast<size_t>(row_begin) * size.x * 4;
+        for (size_t p = 0; p < static_cast<size_t>(row_end - row_begin) * size.x; p++, cell += 4, out += 4) {
+            float weight = cell[3];
+            if (weight <= 0.0f) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                continue;
+            }
+            float inv = 1.0f / weight;
+            out[0] = static_cast<uint8_t>(std::min(255.0f, cell[0] * inv));
+            out[1] = static_cast<uint8_t>(std::min(255.0f, cell[1] * inv));
+            out[2] = static_cast<uint8_t>(std::min(255.0f, cell[2] * inv));
+            out[3] = static_cast<uint8_t>(255.0f * (1.0f - std::exp(-density_exposure * weight)));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned band = 1; band < band_count; band++) workers.emplace_back(splat_band, band);
+    splat_band(0);
+    for (auto& worker : workers) worker.join();
+
+    density_texture->update(density_pixels.data());
+    sf::View original_view = window.getView();
+    window.setView(window.getDefaultView());
+    window.draw(sf::Sprite(*density_texture));
+    window.setView(original_view);
+}
+
 bool GraphRenderer::should_close() {
     return !window.isOpen();
 }
@@ -1150,113 +1862,185 @@ void update_sfml_texture_from_pixels(sf::Texture& texture, const Pixels& pixels)
     texture.update(sfml_pixels.data());
 }
 
-void GraphRenderer::draw_textured_node(sf::RenderWindow& window, const sf::Vector2f& screen_pos, float radius,
-                                       const sf::Color& base_color, float depth, const Vector3& /* world_pos */) {
-    // Create a proper sphere texture with radial gradient lighting
-    // Use instance variable instead of static to avoid exit-time cleanup issues
-    static std::map<int, sf::Texture>* sphere_textures = new std::map<int, sf::Texture>(); // Leak intentionally to avoid exit crash
-    int texture_size = static_cast<int>(radius * 4); // Higher resolution for larger nodes
-    texture_size = std::max(16, std::min(texture_size, 128)); // Clamp size
-
-    // Check if we need to create/recreate the texture
-    if (sphere_textures->find(texture_size) == sphere_textures->end()) {
-        // Create sphere texture with proper lighting
-        sf::Image sphere_image;
-        sphere_image.resize(sf::Vector2u(texture_size, texture_size));
-        // Initialize with transparent pixels
-        for (int y = 0; y < texture_size; y++) {
-            for (int x = 0; x < texture_size; x++) {
-                sphere_image.setPixel(sf::Vector2u(x, y), sf::Color::Transparent);
-            }
-        }
-
-        float center = texture_size / 2.0f;
-        float max_radius = center;
-
-        // Light direction (normalized) - coming from top-left-front
-        Vector3 light_dir = lighting.directional_light_dir;
-        light_dir = light_dir.normalize();
+void GraphRenderer::layout_sphere_atlas() {
+    // One sphere and one outline ring per level, side by side; each node uses the
+    // smallest level that still supersamples it about 2x, like the old per-size cache
+    const int level_sizes[] = {16, 32, 64, 128};
+    const int pad = 2; // keeps smooth sampling from bleeding between cells
+
+    sphere_atlas_levels.clear();
+    int atlas_width = 0;
+    for (int size : level_sizes) {
+        sphere_atlas_levels.push_back(AtlasLevel{static_cast<float>(atlas_width), static_cast<float>(size)});
+        atlas_width += size + pad;
+    }
+    sphere_atlas_ring_top = static_cast<float>(level_sizes[3] + pad);
+    sphere_atlas_size = sf::Vector2u(atlas_width, 2 * (level_sizes[3] + pad));
+}
 
-        for (int y = 0; y < texture_size; y++) {
-            for (int x = 0; x < texture_size; x++) {
-                float dx = x - center;
-                float dy = y - center;
-                float distance_from_center = sqrt(dx*dx + dy*dy);
+std::vector<uint8_t> GraphRenderer::bake_sphere_atlas_pixels(const LightingParams& light) const {
+    unsigned atlas_width = sphere_atlas_size.x;
+    unsigned atlas_height = sphere_atlas_size.y;
+    std::vector<uint8_t> pixels(static_cast<size_t>(atlas_width) * atlas_height * 4, 0); // transparent
+
+    // Light direction (normalized) - coming from top-left-front
+    Vector3 light_dir = light.directional_light_dir.normalize();
+    Vector3 view_dir(0, 0, 1); // Looking straight down Z axis
+    Vector3 half_dir = (light_dir + view_dir).normalize();
+
+    auto bake_rows = [&](unsigned first_row, unsigned row_step) {
+        for (unsigned row = first_row; row < atlas_height; row += row_step) {
+            bool ring_row = row >= sphere_atlas_ring_top;
+            int y = static_cast<int>(ring_row ? row - sphere_atlas_ring_top : row);
+
+            for (const AtlasLevel& level : sphere_atlas_levels) {
+                int texture_size = static_cast<int>(level.size);
+                if (y >= texture_size) continue;
+
+                float center = texture_size / 2.0f;
+                float max_radius = center;
+                float ring_width = std::max(1.0f, texture_size / 32.0f);
+                uint8_t* out = &pixels[(static_cast<size_t>(row) * atlas_width + static_cast<size_t>(level.x)) * 4];
+
+                for (int x = 0; x < texture_size; x++, out += 4) {
+                    float dx = x - center;
+                    float dy = y - center;
+                    float distance_from_center = std::sqrt(dx*dx + dy*dy);
+                    if (distance_from_center > max_radius) continue;
+
+                    if (ring_row) {
+                        // Outline ring: white, tinted per node with the outline alpha
+                        float inset = max_radius - distance_from_center;
+                        float ring_alpha = std::min(1.0f, inset) * std::min(1.0f, std::max(0.0f, ring_width - inset + 1.0f));
+                        out[0] = out[1] = out[2] = 255;
+                        out[3] = static_cast<uint8_t>(255 * ring_alpha);
+                        continue;
+                    }
 
-                if (distance_from_center <= max_radius) {
                     // Calculate sphere surface normal at this point
                     float nx = dx / max_radius; // Normalized X
                     float ny = dy / max_radius; // Normalized Y
                     float nz_sq = 1.0f - (nx*nx + ny*ny); // Z component squared
+                    if (nz_sq <= 0) continue;
 
-                    if (nz_sq > 0) {
-                        float nz = sqrt(nz_sq); // Z component (always positive, facing towards viewer)
-                        Vector3 normal(nx, ny, nz);
-
-                        // Calculate lighting
-                        float diffuse = std::max(0.0f, normal.x * light_dir.x + normal.y * light_dir.y + normal.z * light_dir.z);
+                    float nz = std::sqrt(nz_sq); // Z component (always positive, facing towards viewer)
+                    Vector3 normal(nx, ny, nz);
 
-                        // Specular highlight (Blinn-Phong)
-                        Vector3 view_dir(0, 0, 1); // Looking straight down Z axis
-                        Vector3 half_dir = light_dir + view_dir;
-                        half_dir = half_dir.normalize();
-                        float specular = pow(std::max(0.0f, normal.x * half_dir.x + normal.y * half_dir.y + normal.z * half_dir.z), 64.0f);
+                    // Calculate lighting
+                    float diffuse = std::max(0.0f, normal.x * light_dir.x + normal.y * light_dir.y + normal.z * light_dir.z);
 
-                        // Combine lighting
-                        float ambient = lighting.ambient_intensity;
-                        float total_light = ambient + lighting.directional_intensity * diffuse + 0.4f * specular;
-                        total_light = std::min(1.0f, total_light);
+                    // Specular highlight (Blinn-Phong)
+                    float specular = std::pow(std::max(0.0f, normal.x * half_dir.x + normal.y * half_dir.y + normal.z * half_dir.z), 64.0f);
 
-                        // Edge darkening for more depth
-                        float edge_factor = 1.0f - (distance_from_center / max_radius);
-                        edge_factor = 0.3f + 0.7f * edge_factor; // Don't go completely black at edges
-                        total_light *= edge_factor;
+                    // Combine lighting
+                    float total_light = light.ambient_intensity + light.directional_intensity * diffuse + 0.4f * specular;
+                    total_light = std::min(1.0f, total_light);
 
-                        // Set pixel color (white texture that will be tinted by base_color)
-                        uint8_t intensity = static_cast<uint8_t>(255 * total_light);
-                        uint8_t alpha = 255;
+                    // Edge darkening for more depth
+                    float edge_factor = 1.0f - (distance_from_center / max_radius);
+                    edge_factor = 0.3f + 0.7f * edge_factor; // Don't go completely black at edges
+                    total_light *= edge_factor;
 
-                        // Soft edges with antialiasing
-                        if (distance_from_center > max_radius - 1.0f) {
-                            float edge_alpha = max_radius - distance_from_center;
-                            alpha = static_cast<uint8_t>(255 * edge_alpha);
-                        }
+                    // White texel that will be tinted by the node colour
+                    uint8_t intensity = static_cast<uint8_t>(255 * total_light);
+                    uint8_t alpha = 255;
 
-                        sphere_image.setPixel(sf::Vector2u(x, y), sf::Color(intensity, intensity, intensity, alpha));
+                    // Soft edges with antialiasing
+                    if (distance_from_center > max_radius - 1.0f) {
+                        alpha = static_cast<uint8_t>(255 * (max_radius - distance_from_center));
                     }
+
+                    out[0] = out[1] = out[2] = intensity;
+                    out[3] = alpha;
                 }
             }
         }
+    };
+
+    // Interleaved rows spread the large (expensive) levels evenly over workers
+    unsigned worker_count = std::max(1u, std::min(std::thread::hardware_concurrency(), atlas_height));
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < worker_count; w++) workers.emplace_back(bake_rows, w, worker_count);
+    bake_rows(0, worker_count);
+    for (auto& worker : workers) worker.join();
+    return pixels;
+}
 
-        // Create texture from image
-        sf::Texture& texture = (*sphere_textures)[texture_size];
-        if (!texture.loadFromImage(sphere_image)) {
-            return; // Failed to create texture
+void GraphRenderer::upload_sphere_atlas(const std::vector<uint8_t>& pixels) {
+    if (!sphere_atlas) {
+        sphere_atlas = new sf::Texture();
+        if (!sphere_atlas->resize(sphere_atlas_size)) {
+            std::cerr << "Failed to create sphere atlas texture" << std::endl;
+            delete sphere_atlas;
+            sphere_atlas = nullptr;
+            return;
         }
-        texture.setSmooth(true); // Enable antialiasing
+        sphere_atlas->setSmooth(true); // Enable antialiasing
     }
+    sphere_atlas->update(pixels.data());
+}
 
-    // Draw the textured sphere
-    sf::Sprite sphere_sprite((*sphere_textures)[texture_size]);
-    sphere_sprite.setColor(base_color); // Tint the white texture with the base color
+void GraphRenderer::refresh_sphere_atlas() {
+    if (!sphere_atlas) {
+        // Normally baked in init_window; covers rendering without it
+        layout_sphere_atlas();
+        upload_sphere_atlas(bake_sphere_atlas_pixels(lighting));
+        sphere_atlas_stale = false;
+        return;
+    }
 
-    // Scale sprite to match desired radius
-    float scale_factor = (radius * 2) / texture_size;
-    sphere_sprite.setScale(sf::Vector2f(scale_factor, scale_factor));
+    // Swap in a finished rebake; the previous atlas stays bound until then
+    if (sphere_atlas_rebake.valid() &&
+        sphere_atlas_rebake.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        upload_sphere_atlas(sphere_atlas_rebake.get());
+    }
 
-    // Position sprite centered on screen_pos
-    sphere_sprite.setPosition(sf::Vector2f(screen_pos.x - radius, screen_pos.y - radius));
+    // One rebake in flight at a time; changes made meanwhile start the next one
+    if (sphere_atlas_stale && !sphere_atlas_rebake.valid()) {
+        sphere_atlas_stale = false;
+        LightingParams snapshot = lighting;
+        sphere_atlas_rebake = std::async(std::launch::async, [this, snapshot]() {
+            return bake_sphere_atlas_pixels(snapshot);
+        });
+    }
+}
+
+static void append_quad(std::vector<sf::Vertex>& vertices, const sf::Vector2f& top_left, float extent,
+                        const sf::Vector2f& tex_top_left, float tex_extent, const sf::Color& color) {
+    sf::Vector2f corners[4] = {top_left, top_left + sf::Vector2f(extent, 0), top_left + sf::Vector2f(extent, extent),
+                               top_left + sf::Vector2f(0, extent)};
+    sf::Vector2f tex[4] = {tex_top_left, tex_top_left + sf::Vector2f(tex_extent, 0),
+                           tex_top_left + sf::Vector2f(tex_extent, tex_extent), tex_top_left + sf::Vector2f(0, tex_extent)};
+    const int order[6] = {0, 1, 2, 0, 2, 3}; // two triangles
+    for (int corner : order) {
+        sf::Vertex vertex;
+        vertex.position = corners[corner];
+        vertex.color = color;
+        vertex.texCoords = tex[corner];
+        vertices.push_back(vertex);
+    }
+}
+
+void GraphRenderer::append_node_quads(std::vector<sf::Vertex>& vertices, const sf::Vector2f& screen_pos, float radius,
+                                      const sf::Color& base_color, float depth) {
+    float wanted_size = radius * 4; // Higher resolution for larger nodes
+    const AtlasLevel* level = &sphere_atlas_levels.back();
+    for (const AtlasLevel& candidate : sphere_atlas_levels) {
+        if (candidate.size >= wanted_size) {
+            level = &candidate;
+            break;
+        }
+    }
 
-    window.draw(sphere_sprite);
+    // Sphere, tinted with the lit node colour
+    sf::Vector2f top_left(screen_pos.x - radius, screen_pos.y - radius);
+    append_quad(vertices, top_left, radius * 2, sf::Vector2f(level->x, 0), level->size, base_color);
 
-    // Add subtle outline for depth (optional, makes nodes pop more)
-    sf::CircleShape outline(radius);
-    outline.setFillColor(sf::Color::Transparent);
+    // Subtle outline for depth (makes nodes pop more); thinner far outlines fade out instead
     float outline_alpha = std::max(20.0f, 100.0f * (1.0f - depth / 50.0f));
-    outline.setOutlineThickness(std::max(0.3f, 1.0f - depth / 40.0f));
-    outline.setOutlineColor(sf::Color(255, 255, 255, static_cast<uint8_t>(outline_alpha)));
-    outline.setPosition(sf::Vector2f(screen_pos.x - radius, screen_pos.y - radius));
-    window.draw(outline);
+    float outline_thickness = std::max(0.3f, 1.0f - depth / 40.0f);
+    sf::Color outline_color(255, 255, 255, static_cast<uint8_t>(std::min(255.0f, outline_alpha * outline_thickness)));
+    append_quad(vertices, top_left, radius * 2, sf::Vector2f(level->x, sphere_atlas_ring_top), level->size, outline_color);
 }
 
 void GraphRenderer::handle_trackpad_gesture_begin(unsigned int finger, const sf::Vector2f& position) {
@@ -4,10 +4,14 @@
 #include <SFML/Window.hpp>
 #include <SFML/System.hpp>
 #include <array>
+#include <future>
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include "graph.hpp"
+#include "node_bvh.hpp"
+#include "edge_bundling.hpp"
 #include "swaptube_pixels.hpp"
 
 #ifdef __APPLE__
@@ -177,11 +181,19 @@ private:
     float apply_perspective(float z_depth);
     sf::Color apply_lighting(const Vector3& position, const Vector3& normal, const sf::Color& base_color);
     sf::Color apply_fog(const sf::Color& color, float depth);
+    float fog_factor(float depth) const;
+    sf::Color apply_fog_factor(const sf::Color& color, float fog) const;
     float calculate_depth_shade(float depth);
+    void draw_edges(const Graph3D& graph);
+    sf::Color shade_edge_color(const Vector3& edge_center, float depth, uint32_t bundle);
     void draw_3d_line(const Vector3& start, const Vector3& end, const sf::Color& color, float thickness = 1.0f);
     void draw_3d_sphere(const Vector3& center, float radius, const sf::Color& color);
-    void draw_textured_node(sf::RenderWindow& window, const sf::Vector2f& screen_pos, float radius, 
-                           const sf::Color& base_color, float depth, const Vector3& world_pos);
+    void layout_sphere_atlas();
+    std::vector<uint8_t> bake_sphere_atlas_pixels(const LightingParams& light) const; // RGBA, no GL: safe off-thread
+    void upload_sphere_atlas(const std::vector<uint8_t>& pixels);
+    void refresh_sphere_atlas(); // Picks up finished rebakes and starts one after lighting changes
+    void append_node_quads(std::vector<sf::Vertex>& vertices, const sf::Vector2f& screen_pos, float radius,
+                           const sf::Color& base_color, float depth);
     void handle_trackpad_gesture_begin(unsigned int finger, const sf::Vector2f& position);
     void handle_trackpad_gesture_move(unsigned int finger, const sf::Vector2f& position);
     void handle_trackpad_gesture_end(unsigned int finger);
@@ -190,6 +202,115 @@ private:
     void draw_help_overlay_sfml();
     std::vector<UISlider> ui_sliders;
     void layout_ui_sliders();
+
+    // Batched node drawing: every node is a tinted sphere quad plus an outline
+    // ring quad, both cut from one atlas, so all nodes go out in a single draw
+    struct AtlasLevel { float x; float size; }; // sphere at (x, 0), ring at (x, ring_top)
+    std::vector<AtlasLevel> sphere_atlas_levels;
+    sf::Vector2u sphere_atlas_size;
+    float sphere_atlas_ring_top = 0.0f;
+    sf::Texture* sphere_atlas = nullptr; // Leaked on purpose like the old texture cache (exit-time GL teardown)
+    bool sphere_atlas_stale = false;     // Lighting changed since the last bake started
+    std::future<std::vector<uint8_t>> sphere_atlas_rebake;
+    std::vector<sf::Vertex> node_vertices; // Reused every frame
+
+    // Persistent edge geometry: two vertices per edge slot, mirrored on the CPU so
+    // only edges whose ends moved over a pixel (or changed colour) are re-uploaded
+    sf::VertexBuffer edge_buffer{sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Stream};
+    std::vector<sf::Vertex> edge_vertices;       // what edge_buffer holds
+    std::vector<uint64_t> edge_slot_keys;        // from/to/visibility each slot was built for
+    std::vector<uint8_t> edge_slot_culled;       // slot holds a culled (off-screen or sub-pixel) edge
+    std::vector<uint32_t> edge_slot_bundle;      // bundle size each slot was built for (0 = absorbed)
+    std::vector<uint32_t> edge_bundle_size;      // scratch, this frame's bundle sizes
+    std::unordered_map<uint64_t, uint32_t> edge_bundle_leaders; // scratch, display pair -> leading slot
+    std::array<float, 21> edge_view_state{};     // camera/lighting inputs of the last build
+
+    // Bundled edges: an EdgeBundler job runs in the background over a snapshot
+    // of the layout, one at a time, once the layout settles (or the last result
+    // grows old), refining that result. Slot i of bundle_buffer holds edge i's
+    // polyline as 2 * (points + 1) line vertices, following its endpoints'
+    // current positions until the next result
+    EdgeBundler::Result edge_bundles;
+    std::future<EdgeBundler::Result> edge_bundle_job;
+    std::vector<uint64_t> edge_bundle_job_keys;  // edge slots the latest job was started for
+    sf::Clock edge_bundle_settle;                // time since nodes or edge slots last changed
+    sf::Clock edge_bundle_age;                   // time since the latest result arrived
+    float edge_bundle_settle_seconds = 0.25f;
+    float edge_bundle_max_age_seconds = 2.0f;
+    bool edge_bundles_stale = true;              // layout moved since the latest job's snapshot
+    bool edge_bundles_fresh = false;             // a new result arrived: every slot rebuilds
+    bool edge_pass_bundled = false;              // which edge pass ran last frame
+    sf::VertexBuffer bundle_buffer{sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Stream};
+    std::vector<sf::Vertex> bundle_vertices;     // what bundle_buffer holds
+    std::vector<uint64_t> bundle_slot_keys;
+    std::vector<uint8_t> bundle_slot_culled;
+    std::array<float, 21> bundle_view_state{};
+    void refresh_edge_bundles(const Graph3D& graph);
+    void draw_bundled_edges(const Graph3D& graph);
+
+    // Camera transform, refreshed by update_camera_position (and render dimension
+    // changes): rows give screen x, screen y and view depth as dot(row.xyz, p) + row.w
+    struct CameraTransform { float rows[3][4]; };
+    CameraTransform camera_transform{};
+    void update_camera_transform();
+
+    // Per-frame projected-node cache, filled once by project_nodes and read by the
+    // edge and node passes: screen position, view depth, on-screen radius and fog
+    struct ProjectedNodes { std::vector<float> x, y, depth, radius, fog; };
+    ProjectedNodes projected;
+    float projected_max_radius = 0.0f;
+    std::vector<Vector3> last_node_positions;    // positions at the previous projection
+    std::vector<uint8_t> node_moved;             // per node, since the previous projection
+    bool any_node_moved = true;
+    void project_nodes(const Graph3D& graph);
+
+    // View culling: a BVH over node positions (refit when nodes move) rejects
+    // whole off-screen regions, so culled nodes skip lighting and submission
+    NodeBVH node_bvh;
+    std::vector<uint8_t> node_in_view;
+    void cull_nodes(const Graph3D& graph);
+
+    // Level of detail: BVH subtrees whose screen extent falls under
+    // lod_cluster_pixels are drawn as one impostor sphere (members' mean colour,
+    // area-summed radius), and edges between impostors merge into bundle lines.
+    // A cluster is drawn in the place of its representative member in the draw order.
+    struct NodeCluster {
+        Vector3 centroid;
+        sf::Vector2f screen;
+        sf::Color color;
+        float radius;
+        float depth;
+        uint32_t members;
+    };
+    std::vector<NodeCluster> node_clusters;
+    std::vector<int32_t> node_cluster;           // per node: cluster index, or -1
+    std::vector<uint32_t> display_id;            // per node: itself, or its cluster's representative
+    std::vector<uint32_t> last_display_id;
+    std::vector<sf::Vector2f> display_pos;       // per node: where its edges attach this frame
+    std::vector<sf::Vector2f> last_display_pos;
+    std::vector<uint8_t> display_changed;        // per node: attachment moved since the last frame
+
+    // Density mode: instead of a sphere per node, nodes are splatted (bilinear,
+    // additive) into a float grid by horizontal bands on worker threads, tone
+    // mapped to RGBA and uploaded as one texture per frame
+    std::vector<float> density_grid;             // 4 floats per pixel: r, g, b, weight
+    std::vector<uint8_t> density_pixels;         // tone-mapped RGBA
+    std::vector<uint32_t> density_band_start;    // nodes binned by band (counting sort)
+    std::vector<uint32_t> density_band_nodes;
+    sf::Vector2u density_size{0, 0};
+    sf::Texture* density_texture = nullptr;      // Leaked on purpose like the sphere atlas
+    void draw_density(const Graph3D& graph);
+    void draw_frame_stats();
+
+    // Painter's-algorithm order (far to near) of the visible nodes, kept across
+    // frames: reused when nothing moved, repaired by insertion sort when the
+    // frame is coherent, otherwise rebuilt by a radix sort on quantised depth
+    std::vector<uint32_t> node_draw_order;
+    std::vector<uint8_t> draw_order_visible;  // visibility the order was built for
+    std::vector<float> draw_order_depths;     // projected depths it was built from
+    std::vector<uint32_t> draw_order_scratch;
+    std::vector<uint16_t> draw_order_keys;
+    void update_node_draw_order(const Graph3D& graph);
     float slider_panel_x = 50.0f;
     float slider_panel_y = 80.0f;
     float slider_panel_padding = 12.0f;
@@ -210,7 +331,28 @@ private:
         return Vector3(v.x, v.y * wy, v.z * wz);
     }
 public:
-    void set_render_dimension(float d) { render_dimension = std::max(1.0f, std::min(3.0f, d)); }
+    // What the last render_frame drew and culled (hidden nodes/edges count as neither)
+    struct FrameStats {
+        uint32_t nodes_drawn = 0;
+        uint32_t nodes_culled = 0;
+        uint32_t nodes_clustered = 0;
+        uint32_t clusters_drawn = 0;
+        uint32_t edges_drawn = 0;
+        uint32_t edges_culled = 0;
+        uint32_t edges_bundled = 0;
+    };
+    FrameStats frame_stats;
+    bool show_frame_stats = true;
+    bool lod_enabled = true;
+    bool density_mode = false;
+    bool edge_bundling = false;
+    float density_exposure = 0.6f;   // tone mapping: alpha = 1 - exp(-exposure * splat weight)
+    float lod_cluster_pixels = 8.0f; // subtrees narrower than this on screen become impostors
+
+    void set_render_dimension(float d) {
+        render_dimension = std::max(1.0f, std::min(3.0f, d));
+        update_camera_transform();
+    }
     float get_render_dimension() const { return render_dimension; }
 };
 
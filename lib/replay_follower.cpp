@@ -0,0 +1,175 @@
+#include "replay_follower.hpp"
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+ReplayFollower::~ReplayFollower() {
+    close();
+}
+
+bool ReplayFollower::open(const std::string& filename) {
+    close();
+
+    // Non-blocking so opening a FIFO does not wait for a writer and reads never stall a frame
+    fd = ::open(filename.c_str(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << filename << " for following" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    is_fifo = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+
+#ifdef __linux__
+    if (!is_fifo) {
+        watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_fd >= 0 && inotify_add_watch(watch_fd, filename.c_str(), IN_MODIFY) < 0) {
+            ::close(watch_fd);
+            watch_fd = -1;
+        }
+        if (watch_fd < 0) {
+            std::cerr << "inotify unavailable, checking " << filename << " for appends every poll" << std::endl;
+        }
+    }
+#endif
+
+    std::cout << "Following " << (is_fifo ? "FIFO " : "file ") << filename << std::endl;
+    return true;
+}
+
+void ReplayFollower::close() {
+    if (watch_fd >= 0) ::close(watch_fd);
+    if (fd >= 0) ::close(fd);
+    watch_fd = -1;
+    fd = -1;
+    primed = false;
+    pending.clear();
+    format = ReplayFormat::Unknown;
+    item_ids.clear();
+    agent_index_by_id.clear();
+}
+
+bool ReplayFollower::wait_for_data(int timeout_ms) {
+    // Without inotify a regular file is always "readable"; read() reports 0 bytes at EOF
+    if (!is_fifo && watch_fd < 0) return true;
+
+    struct pollfd pfd;
+    pfd.fd = is_fifo ? fd : watch_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (::poll(&pfd, 1, timeout_ms) <= 0) return false;
+
+#ifdef __linux__
+    if (watch_fd >= 0) {
+        // Drain queued events; any number of them just means "read to EOF"
+        char events[4096];
+        while (::read(watch_fd, events, sizeof(events)) > 0) {}
+    }
+#endif
+    return true;
+}
+
+bool ReplayFollower::read_available() {
+    bool got_data = false;
+    char buffer[65536];
+    while (true) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n <= 0) break;  // EOF (writer idle or gone) or EAGAIN
+        pending.append(buffer, static_cast<size_t>(n));
+        got_data = true;
+    }
+    return got_data;
+}
+
+bool ReplayFollower::poll(ReplayData& replay, std::vector<size_t>& changed_agents, int timeout_ms) {
+    if (fd < 0) return false;
+
+    // The first poll reads whatever the file already holds
+    bool wake = !primed || wait_for_data(timeout_ms);
+    primed = true;
+    if (!wake || !read_available()) return false;
+
+    bool applied = false;
+    size_t line_start = 0;
+    size_t newline;
+    while ((newline = pending.find('\n', line_start)) != std::string::npos) {
+        std::string line = pending.substr(line_start, newline - line_start);
+        line_start = newline + 1;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        applied |= apply_line(line, replay, changed_agents);
+    }
+    pending.erase(0, line_start);
+
+    // Appended events make any materialised tensor stale
+    if (applied && replay.dense_inventory.valid()) {
+        replay.dense_inventory = InventoryTensor();
+    }
+    return applied;
+}
+
+bool ReplayFollower::apply_line(const std::string& line, ReplayData& replay, std::vector<size_t>& changed_agents) {
+    cJSON* json = cJSON_Parse(line.c_str());
+    if (!json) {
+        std::cerr << "Skipping malformed replay line (" << line.size() << " bytes)" << std::endl;
+        return false;
+    }
+
+    size_t changed_before = changed_agents.size();
+    if (format == ReplayFormat::Unknown) {
+        // The first line is the replay header; any agents it already lists are applied too
+        format = ReplayParser::parse_replay_header(json, replay);
+        if (format == ReplayFormat::Unknown) {
+            std::cerr << "Replay header declares neither grid_objects nor objects" << std::endl;
+        } else {
+            std::cout << "Follow stream format: " << ReplayParser::format_name(format) << std::endl;
+            item_ids = ReplayParser::intern_declared_items(format, replay);
+            replay.max_timestep = 0;
+
+            cJSON* objects_array = cJSON_GetObjectItem(json, format == ReplayFormat::Objects ? "objects" : "grid_objects");
+            if (cJSON_IsArray(objects_array)) {
+                cJSON* obj;
+                cJSON_ArrayForEach(obj, objects_array) {
+                    apply_agent(obj, replay, changed_agents);
+                }
+            }
+        }
+    } else {
+        apply_agent(json, replay, changed_agents);
+    }
+
+    cJSON_Delete(json);
+    return changed_agents.size() != changed_before;
+}
+
+void ReplayFollower::apply_agent(cJSON* obj, ReplayData& replay, std::vector<size_t>& changed_agents) {
+    if (!ReplayParser::is_agent_object(obj, format)) return;
+
+    AgentInventoryState delta;
+    ReplayParser::parse_agent_object(obj, format, replay.items.get(), replay.inventory_items, item_ids, delta);
+    delta.item_table = replay.items;
+
+    for (const auto& loc : delta.location_over_time) {
+        replay.max_timestep = std::max(replay.max_timestep, loc.first);
+    }
+
+    size_t agent_index;
+    auto it = agent_index_by_id.find(delta.agent_id);
+    if (it == agent_index_by_id.end()) {
+        agent_index = replay.agents.size();
+        agent_index_by_id.emplace(delta.agent_id, agent_index);
+        replay.add_agent(delta);
+    } else {
+        agent_index = it->second;
+        replay.agents[agent_index].append_events(delta);
+    }
+
+    if (std::find(changed_agents.begin(), changed_agents.end(), agent_index) == changed_agents.end()) {
+        changed_agents.push_back(agent_index);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "replay_parser.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cjson/cJSON.h>
+
+// Tails a replay that a training run is still writing. The stream is JSON
+// Lines: first the replay header (the usual top-level object; its
+// "grid_objects" / "objects" array may be empty), then one agent object per
+// line carrying only the events appended since that agent's previous line.
+// Regular files wake on inotify IN_MODIFY (Linux; elsewhere each poll just
+// tries a read), FIFOs wake on the descriptor itself.
+class ReplayFollower {
+public:
+    ReplayFollower() = default;
+    ~ReplayFollower();
+    ReplayFollower(const ReplayFollower&) = delete;
+    ReplayFollower& operator=(const ReplayFollower&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const { return fd >= 0; }
+
+    // Wait up to timeout_ms (0 = just check) for new data and apply every
+    // complete line to replay. Indices of agents that received events are
+    // appended to changed_agents. Returns true when anything was applied.
+    bool poll(ReplayData& replay, std::vector<size_t>& changed_agents, int timeout_ms = 0);
+
+private:
+    bool wait_for_data(int timeout_ms);
+    bool read_available();
+    bool apply_line(const std::string& line, ReplayData& replay, std::vector<size_t>& changed_agents);
+    void apply_agent(cJSON* obj, ReplayData& replay, std::vector<size_t>& changed_agents);
+
+    int fd = -1;
+    int watch_fd = -1;          // inotify instance (Linux, regular files only)
+    bool is_fifo = false;
+    bool primed = false;        // existing contents have been read
+    std::string pending;        // bytes after the last complete line
+    ReplayFormat format = ReplayFormat::Unknown;
+    std::vector<int> item_ids;  // file item index -> interned id
+    std::unordered_map<int, size_t> agent_index_by_id;
+};
@@ -6,74 +6,394 @@
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include <climits>
+#include <iterator>
+#include <thread>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <functional>
+#include <random>
+
+// ItemTable methods
+int ItemTable::intern(const std::string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+
+    int id = static_cast<int>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+int ItemTable::find(const std::string& name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? -1 : it->second;
+}
 
 // AgentInventoryState methods
-float AgentInventoryState::get_inventory_at_time(const std::string& item, int timestep) const {
-    auto it = inventory_over_time.find(item);
-    if (it == inventory_over_time.end()) return 0.0f;
-    
-    const auto& values = it->second;
-    if (values.empty()) return 0.0f;
-    
-    // Find the most recent value before or at timestep
-    float current_value = 0.0f;
-    for (const auto& tv : values) {
-        if (tv.timestep <= timestep) {
-            current_value = tv.value;
-        } else {
-            break;
+void AgentInventoryState::set_inventory_columns(const std::vector<std::vector<TimestampValue>>& per_item) {
+    size_t total = 0;
+    for (const auto& values : per_item) total += values.size();
+
+    item_offsets.clear();
+    item_ends.clear();
+    item_limits.clear();
+    item_offsets.reserve(per_item.size());
+    item_ends.reserve(per_item.size());
+    item_limits.reserve(per_item.size());
+    inv_timesteps.clear();
+    inv_values.clear();
+    inv_timesteps.reserve(total);
+    inv_values.reserve(total);
+    unused_slots = 0;
+
+    for (const auto& values : per_item) {
+        item_offsets.push_back(static_cast<uint32_t>(inv_timesteps.size()));
+        for (const auto& tv : values) {
+            inv_timesteps.push_back(tv.timestep);
+            inv_values.push_back(tv.value);
         }
+        item_ends.push_back(static_cast<uint32_t>(inv_timesteps.size()));
+        item_limits.push_back(item_ends.back());
     }
-    return current_value;
 }
 
-float AgentInventoryState::get_reward_at_time(int timestep) const {
-    for (const auto& tv : reward_over_time) {
-        if (tv.timestep == timestep) return tv.value;
+void AgentInventoryState::append_events(const AgentInventoryState& delta) {
+    const uint32_t min_room = 8;
+
+    // Items first seen in this slice start as empty ranges at the end
+    while (item_count() < delta.item_count()) {
+        uint32_t end = static_cast<uint32_t>(inv_timesteps.size());
+        item_offsets.push_back(end);
+        item_ends.push_back(end);
+        item_limits.push_back(end);
     }
+
+    size_t events = 0;
+    for (size_t i = 0; i < delta.item_count(); i++) {
+        InventorySeries series = delta.inventory_series(static_cast<int>(i));
+        if (series.empty()) continue;
+        events += series.size;
+
+        uint32_t needed = item_ends[i] + static_cast<uint32_t>(series.size);
+        if (needed > item_limits[i]) {
+            uint32_t size = item_ends[i] - item_offsets[i];
+            uint32_t room = std::max(min_room, 2 * (size + static_cast<uint32_t>(series.size)));
+            if (item_limits[i] == inv_timesteps.size()) {
+                // Last range in the columns: just extend it
+                item_limits[i] = item_offsets[i] + room;
+            } else {
+                // Move the range to the end with double the room
+                uint32_t begin = static_cast<uint32_t>(inv_timesteps.size());
+                unused_slots += item_limits[i] - item_offsets[i];
+                inv_timesteps.resize(begin + size);
+                inv_values.resize(begin + size);
+                std::copy(inv_timesteps.begin() + item_offsets[i], inv_timesteps.begin() + item_ends[i], inv_timesteps.begin() + begin);
+                std::copy(inv_values.begin() + item_offsets[i], inv_values.begin() + item_ends[i], inv_values.begin() + begin);
+                item_offsets[i] = begin;
+                item_ends[i] = begin + size;
+                item_limits[i] = begin + room;
+            }
+            inv_timesteps.resize(item_limits[i]);
+            inv_values.resize(item_limits[i]);
+        }
+        std::copy(series.timesteps, series.timesteps + series.size, inv_timesteps.begin() + item_ends[i]);
+        std::copy(series.values, series.values + series.size, inv_values.begin() + item_ends[i]);
+        item_ends[i] += static_cast<uint32_t>(series.size);
+    }
+
+    // Repack once moved ranges have abandoned more slots than are still in use,
+    // leaving each item as much room again as it has events
+    if (events > 0 && unused_slots > inv_timesteps.size() / 2) {
+        std::vector<int> timesteps;
+        std::vector<float> values;
+        timesteps.reserve(inv_timesteps.size() - unused_slots);
+        values.reserve(inv_timesteps.size() - unused_slots);
+        for (size_t i = 0; i < item_count(); i++) {
+            uint32_t begin = static_cast<uint32_t>(timesteps.size());
+            uint32_t size = item_ends[i] - item_offsets[i];
+            timesteps.insert(timesteps.end(), inv_timesteps.begin() + item_offsets[i], inv_timesteps.begin() + item_ends[i]);
+            values.insert(values.end(), inv_values.begin() + item_offsets[i], inv_values.begin() + item_ends[i]);
+            timesteps.resize(begin + 2 * size);
+            values.resize(begin + 2 * size);
+            item_offsets[i] = begin;
+            item_ends[i] = begin + size;
+            item_limits[i] = begin + 2 * size;
+        }
+        inv_timesteps.swap(timesteps);
+        inv_values.swap(values);
+        unused_slots = 0;
+    }
+
+    reward_over_time.insert(reward_over_time.end(), delta.reward_over_time.begin(), delta.reward_over_time.end());
+    total_reward_over_time.insert(total_reward_over_time.end(),
+                                  delta.total_reward_over_time.begin(), delta.total_reward_over_time.end());
+    location_over_time.insert(location_over_time.end(), delta.location_over_time.begin(), delta.location_over_time.end());
+}
+
+InventorySeries AgentInventoryState::inventory_series(int item_id) const {
+    if (item_id < 0 || static_cast<size_t>(item_id) >= item_count()) {
+        return InventorySeries{nullptr, nullptr, 0};
+    }
+    uint32_t begin = item_offsets[item_id];
+    uint32_t end = item_ends[item_id];
+    return InventorySeries{inv_timesteps.data() + begin, inv_values.data() + begin, end - begin};
+}
+
+float AgentInventoryState::get_inventory_at_time(int item_id, int timestep) const {
+    InventorySeries series = inventory_series(item_id);
+    if (series.empty()) return 0.0f;
+    
+    // Find the most recent value before or at timestep
+    const int* end = series.timesteps + series.size;
+    const int* it = std::upper_bound(series.timesteps, end, timestep);
+    if (it == series.timesteps) return 0.0f;
+    return series.values[(it - series.timesteps) - 1];
+}
+
+float AgentInventoryState::get_inventory_at_time(const std::string& item, int timestep) const {
+    if (!item_table) return 0.0f;
+    return get_inventory_at_time(item_table->find(item), timestep);
+}
+
+float AgentInventoryState::get_reward_at_time(int timestep) const {
+    auto it = std::lower_bound(reward_over_time.begin(), reward_over_time.end(), timestep,
+                               [](const TimestampValue& tv, int t) { return tv.timestep < t; });
+    if (it != reward_over_time.end() && it->timestep == timestep) return it->value;
     return 0.0f;
 }
 
 float AgentInventoryState::get_total_reward_at_time(int timestep) const {
-    float current_total = 0.0f;
-    for (const auto& tv : total_reward_over_time) {
-        if (tv.timestep <= timestep) {
-            current_total = tv.value;
-        } else {
-            break;
-        }
-    }
-    return current_total;
+    auto it = std::upper_bound(total_reward_over_time.begin(), total_reward_over_time.end(), timestep,
+                               [](int t, const TimestampValue& tv) { return t < tv.timestep; });
+    if (it == total_reward_over_time.begin()) return 0.0f;
+    return std::prev(it)->value;
 }
 
 Vector3 AgentInventoryState::get_location_at_time(int timestep) const {
-    Vector3 current_location(0, 0, 0);
-    for (const auto& loc : location_over_time) {
-        if (loc.first <= timestep) {
-            current_location = loc.second;
-        } else {
-            break;
+    auto it = std::upper_bound(location_over_time.begin(), location_over_time.end(), timestep,
+                               [](int t, const std::pair<int, Vector3>& loc) { return t < loc.first; });
+    if (it == location_over_time.begin()) return Vector3(0, 0, 0);
+    return std::prev(it)->second;
+}
+
+// AgentTimeCursor methods
+AgentTimeCursor::AgentTimeCursor(const AgentInventoryState& agent_state)
+    : agent(&agent_state), total_reward_pos(0), location_pos(0), timestep(INT_MIN) {
+    size_t items = agent_state.item_count();
+    item_pos.resize(items);
+    for (size_t i = 0; i < items; i++) {
+        item_pos[i] = agent_state.item_offsets[i];
+    }
+}
+
+void AgentTimeCursor::advance_to(int target_timestep) {
+    timestep = target_timestep;
+
+    for (size_t i = 0; i < item_pos.size(); i++) {
+        uint32_t end = agent->item_ends[i];
+        uint32_t pos = item_pos[i];
+        while (pos < end && agent->inv_timesteps[pos] <= target_timestep) pos++;
+        item_pos[i] = pos;
+    }
+
+    const auto& totals = agent->total_reward_over_time;
+    while (total_reward_pos < totals.size() && totals[total_reward_pos].timestep <= target_timestep) {
+        total_reward_pos++;
+    }
+
+    const auto& locations = agent->location_over_time;
+    while (location_pos < locations.size() && locations[location_pos].first <= target_timestep) {
+        location_pos++;
+    }
+}
+
+float AgentTimeCursor::inventory(int item_id) const {
+    if (item_id < 0 || static_cast<size_t>(item_id) >= item_pos.size()) return 0.0f;
+    uint32_t pos = item_pos[item_id];
+    if (pos == agent->item_offsets[item_id]) return 0.0f;
+    return agent->inv_values[pos - 1];
+}
+
+float AgentTimeCursor::total_reward() const {
+    if (total_reward_pos == 0) return 0.0f;
+    return agent->total_reward_over_time[total_reward_pos - 1].value;
+}
+
+Vector3 AgentTimeCursor::location() const {
+    if (location_pos == 0) return Vector3(0, 0, 0);
+    return agent->location_over_time[location_pos - 1].second;
+}
+
+// InventoryTensor methods
+size_t InventoryTensor::element_size() const {
+    switch (element_type) {
+        case ElementType::UInt8: return sizeof(uint8_t);
+        case ElementType::Int16: return sizeof(int16_t);
+        default: return sizeof(float);
+    }
+}
+
+float InventoryTensor::at(int agent_index, int timestep, int item_id) const {
+    if (item_id < 0 || item_id >= item_count) return 0.0f;
+    timestep = std::max(0, std::min(timestep, timestep_count - 1));
+    size_t index = static_cast<size_t>(timestep) * item_count + item_id;
+    const uint8_t* slab = agent_data(agent_index);
+    switch (element_type) {
+        case ElementType::UInt8: return slab[index];
+        case ElementType::Int16: return reinterpret_cast<const int16_t*>(slab)[index];
+        default: return reinterpret_cast<const float*>(slab)[index];
+    }
+}
+
+// Fill one agent's [timestep][item] slab by writing each value over the run
+// of timesteps until the next change event
+template <typename T>
+static void fill_inventory_slab(const AgentInventoryState& agent, T* slab, int timestep_count, int item_count) {
+    for (int item_id = 0; item_id < static_cast<int>(agent.item_count()) && item_id < item_count; item_id++) {
+        InventorySeries series = agent.inventory_series(item_id);
+        for (size_t k = 0; k < series.size; k++) {
+            int t_begin = std::max(0, series.timesteps[k]);
+            int t_end = k + 1 < series.size ? series.timesteps[k + 1] : timestep_count;
+            t_end = std::min(t_end, timestep_count);
+            T value = static_cast<T>(series.values[k]);
+            for (int t = t_begin; t < t_end; t++) {
+                slab[static_cast<size_t>(t) * item_count + item_id] = value;
+            }
         }
     }
-    return current_location;
 }
 
 // ReplayData methods
+bool ReplayData::materialize_inventory(size_t max_bytes) {
+    dense_inventory = InventoryTensor();
+    if (agents.empty() || items->size() == 0 || max_timestep < 0) return false;
+
+    // Pick the narrowest element type that holds every observed value exactly
+    bool integral = true;
+    float min_value = 0.0f, max_value = 0.0f;
+    for (const auto& agent : agents) {
+        for (size_t i = 0; i < agent.item_count(); i++) {
+            InventorySeries series = agent.inventory_series(static_cast<int>(i));
+            for (size_t k = 0; k < series.size; k++) {
+                float v = series.values[k];
+                integral = integral && v == std::floor(v);
+                min_value = std::min(min_value, v);
+                max_value = std::max(max_value, v);
+            }
+        }
+    }
+
+    InventoryTensor tensor;
+    if (integral && min_value >= 0.0f && max_value <= 255.0f) {
+        tensor.element_type = InventoryTensor::ElementType::UInt8;
+    } else if (integral && min_value >= -32768.0f && max_value <= 32767.0f) {
+        tensor.element_type = InventoryTensor::ElementType::Int16;
+    } else {
+        tensor.element_type = InventoryTensor::ElementType::Float32;
+    }
+
+    const size_t cache_line = 64;
+    tensor.agent_count = static_cast<int>(agents.size());
+    tensor.timestep_count = max_timestep + 1;
+    tensor.item_count = static_cast<int>(items->size());
+    size_t slab_bytes = static_cast<size_t>(tensor.timestep_count) * tensor.item_count * tensor.element_size();
+    tensor.agent_stride = (slab_bytes + cache_line - 1) / cache_line * cache_line;
+
+    size_t total_bytes = tensor.agent_stride * tensor.agent_count;
+    if (total_bytes > max_bytes) {
+        std::cout << "Skipping dense inventory: " << total_bytes / (1024 * 1024) << " MB exceeds budget" << std::endl;
+        return false;
+    }
+
+    tensor.storage.assign(total_bytes + cache_line, 0);
+    uintptr_t base = reinterpret_cast<uintptr_t>(tensor.storage.data());
+    tensor.data_offset = (cache_line - base % cache_line) % cache_line;
+
+    // Agents are independent, so each worker fills an interleaved subset of slabs
+    unsigned worker_count = std::max(1u, std::min(std::thread::hardware_concurrency(),
+                                                  static_cast<unsigned>(tensor.agent_count)));
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < worker_count; w++) {
+        workers.emplace_back([&, w]() {
+            for (int a = static_cast<int>(w); a < tensor.agent_count; a += worker_count) {
+                uint8_t* slab = tensor.agent_data(a);
+                switch (tensor.element_type) {
+                    case InventoryTensor::ElementType::UInt8:
+                        fill_inventory_slab(agents[a], slab, tensor.timestep_count, tensor.item_count);
+                        break;
+                    case InventoryTensor::ElementType::Int16:
+                        fill_inventory_slab(agents[a], reinterpret_cast<int16_t*>(slab), tensor.timestep_count, tensor.item_count);
+                        break;
+                    default:
+                        fill_inventory_slab(agents[a], reinterpret_cast<float*>(slab), tensor.timestep_count, tensor.item_count);
+                        break;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    dense_inventory = std::move(tensor);
+    std::cout << "Materialized dense inventory: " << dense_inventory.agent_count << " agents x "
+              << dense_inventory.timestep_count << " timesteps x " << dense_inventory.item_count << " items ("
+              << total_bytes / 1024 << " KB, " << dense_inventory.element_size() << " bytes/value)" << std::endl;
+    return true;
+}
+
 void ReplayData::add_agent(const AgentInventoryState& agent) {
     agents.push_back(agent);
 }
 
-const AgentInventoryState* ReplayData::get_agent(int agent_id) const {
+std::shared_ptr<const AgentInventoryState> ReplayData::get_agent(int agent_id) const {
     for (const auto& agent : agents) {
         if (agent.agent_id == agent_id) {
-            return &agent;
+            // Non-owning: `agents` keeps it alive
+            return std::shared_ptr<const AgentInventoryState>(std::shared_ptr<const AgentInventoryState>(), &agent);
         }
     }
-    return nullptr;
+    if (!lazy_source) return nullptr;
+    
+    LazyAgentSource& source = *lazy_source;
+    std::lock_guard<std::mutex> lock(source.mutex);
+    
+    // Cache hit: move to the front of the LRU list
+    auto cached = source.decoded_by_id.find(agent_id);
+    if (cached != source.decoded_by_id.end()) {
+        source.decoded.splice(source.decoded.begin(), source.decoded, cached->second);
+        return source.decoded.front();
+    }
+    
+    auto entry = source.entry_by_id.find(agent_id);
+    if (entry == source.entry_by_id.end()) return nullptr;
+    
+    auto agent = std::make_shared<AgentInventoryState>();
+    if (!ReplayParser::decode_lazy_agent(source, source.entries[entry->second], inventory_items, *agent)) {
+        return nullptr;
+    }
+    agent->item_table = items;
+    
+    source.decoded.push_front(std::move(agent));
+    source.decoded_by_id[agent_id] = source.decoded.begin();
+    
+    // Evict least recently used agents beyond the cache bound; callers still
+    // holding one keep it alive
+    while (source.decoded.size() > std::max<size_t>(1, source.capacity)) {
+        source.decoded_by_id.erase(source.decoded.back()->agent_id);
+        source.decoded.pop_back();
+    }
+    return source.decoded.front();
 }
 
 std::vector<int> ReplayData::get_agent_ids() const {
     std::vector<int> ids;
+    if (lazy_source) {
+        for (const auto& entry : lazy_source->entries) {
+            ids.push_back(entry.agent_id);
+        }
+        return ids;
+    }
     for (const auto& agent : agents) {
         ids.push_back(agent.agent_id);
     }
@@ -101,10 +421,16 @@ bool ReplayParser::parse_compressed_replay_file(const std::string& filename, Rep
     return result;
 }
 
-bool ReplayParser::parse_json_data(const char* json_str, ReplayData& replay_data) {
-    cJSON* json = cJSON_Parse(json_str);
-    if (!json) return false;
-    
+const char* ReplayParser::format_name(ReplayFormat format) {
+    switch (format) {
+        case ReplayFormat::GridObjects: return "grid_objects";
+        case ReplayFormat::Pufferbox: return "pufferbox";
+        case ReplayFormat::Objects: return "objects";
+        default: return "unknown";
+    }
+}
+
+ReplayFormat ReplayParser::parse_replay_header(cJSON* json, ReplayData& replay_data) {
     // Detect format type and parse inventory items list
     bool is_grid_objects_format = cJSON_GetObjectItem(json, "grid_objects") != nullptr;
     bool is_objects_format = cJSON_GetObjectItem(json, "objects") != nullptr;
@@ -167,122 +493,166 @@ bool ReplayParser::parse_json_data(const char* json_str, ReplayData& replay_data
         }
     }
     
+    if (is_pufferbox_format) return ReplayFormat::Pufferbox;
+    if (is_grid_objects_format) return ReplayFormat::GridObjects;
+    if (is_objects_format) return ReplayFormat::Objects;
+    return ReplayFormat::Unknown;
+}
+
+// Pufferbox replays don't declare their items; agents carry "agent:inv:<name>"
+// arrays for these, and names are stored with underscores for consistency
+static const std::vector<std::string>& pufferbox_inventory_items() {
+    static const std::vector<std::string> items = {
+        "ore.red", "ore.blue", "ore.green",
+        "battery", "heart", "armor", "laser", "blueprint"
+    };
+    return items;
+}
+
+static std::string pufferbox_item_name(const std::string& item) {
+    std::string clean_item = item;
+    std::replace(clean_item.begin(), clean_item.end(), '.', '_');
+    return clean_item;
+}
+
+std::vector<int> ReplayParser::intern_declared_items(ReplayFormat format, ReplayData& replay_data) {
+    // Intern declared item names up front so ids follow file order
+    std::vector<int> item_ids;
+    if (format != ReplayFormat::Pufferbox) {
+        for (const std::string& item : replay_data.inventory_items) {
+            item_ids.push_back(replay_data.items->intern(item));
+        }
+    }
+    return item_ids;
+}
+
+bool ReplayParser::is_agent_object(cJSON* obj, ReplayFormat format) {
+    // Check for agent type in both formats
+    if (format == ReplayFormat::Objects) {
+        cJSON* type_id = cJSON_GetObjectItem(obj, "type_id");
+        return cJSON_IsNumber(type_id) && cJSON_GetNumberValue(type_id) == 0;
+    }
+    cJSON* type = cJSON_GetObjectItem(obj, "type");
+    return cJSON_IsNumber(type) && cJSON_GetNumberValue(type) == 0;
+}
+
+void ReplayParser::parse_agent_object(cJSON* obj, ReplayFormat format, ItemTable* items,
+                                      const std::vector<std::string>& inventory_items,
+                                      const std::vector<int>& item_ids, AgentInventoryState& agent) {
+    cJSON* agent_id = cJSON_GetObjectItem(obj, "agent_id");
+    agent.agent_id = cJSON_IsNumber(agent_id) ? static_cast<int>(cJSON_GetNumberValue(agent_id)) : 0;
+    
+    // Parse location trajectory
+    cJSON* location = cJSON_GetObjectItem(obj, "location");
+    if (cJSON_IsArray(location)) {
+        cJSON* loc_entry;
+        cJSON_ArrayForEach(loc_entry, location) {
+            if (cJSON_IsArray(loc_entry) && cJSON_GetArraySize(loc_entry) >= 2) {
+                int timestep = static_cast<int>(cJSON_GetNumberValue(cJSON_GetArrayItem(loc_entry, 0)));
+                cJSON* pos_array = cJSON_GetArrayItem(loc_entry, 1);
+                
+                Vector3 position = parse_location_array(pos_array);
+                agent.location_over_time.push_back({timestep, position});
+            }
+        }
+    }
+    
+    std::cout << "Parsing agent " << agent.agent_id << " - format: " 
+              << format_name(format) << std::endl;
+    
+    // Parse inventory data based on format
+    std::vector<std::vector<TimestampValue>> per_item;
+    if (format == ReplayFormat::GridObjects) {
+        // grid_objects format: "inv:item_name" arrays
+        for (size_t i = 0; i < inventory_items.size(); i++) {
+            std::string inv_key = "inv:" + inventory_items[i];
+            cJSON* inv_data = cJSON_GetObjectItem(obj, inv_key.c_str());
+            if (cJSON_IsArray(inv_data)) {
+                int item_id = item_ids[i];
+                if (per_item.size() <= static_cast<size_t>(item_id)) per_item.resize(item_id + 1);
+                parse_timestamp_array(inv_data, per_item[item_id]);
+            }
+        }
+        
+        // Parse reward data for grid_objects format
+        cJSON* reward = cJSON_GetObjectItem(obj, "reward");
+        if (cJSON_IsArray(reward)) {
+            parse_timestamp_array(reward, agent.reward_over_time);
+        }
+        
+        cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
+        if (cJSON_IsArray(total_reward)) {
+            parse_timestamp_array(total_reward, agent.total_reward_over_time);
+        }
+    } else if (format == ReplayFormat::Pufferbox) {
+        // Pufferbox format with agent:inv: prefix and dots in names
+        const std::vector<std::string>& agent_inv_items = pufferbox_inventory_items();
+        for (size_t i = 0; i < agent_inv_items.size(); i++) {
+            std::string inv_key = "agent:inv:" + agent_inv_items[i];
+            cJSON* inv_data = cJSON_GetObjectItem(obj, inv_key.c_str());
+            if (inv_data && cJSON_IsArray(inv_data) && cJSON_GetArraySize(inv_data) > 0) {
+                int item_id = items ? items->intern(pufferbox_item_name(agent_inv_items[i]))
+                                    : (i < item_ids.size() ? item_ids[i] : -1);
+                if (item_id < 0) continue;
+                if (per_item.size() <= static_cast<size_t>(item_id)) per_item.resize(item_id + 1);
+                parse_timestamp_array(inv_data, per_item[item_id]);
+            }
+        }
+        
+        // Parse reward data
+        cJSON* reward = cJSON_GetObjectItem(obj, "reward");
+        if (cJSON_IsArray(reward)) {
+            parse_timestamp_array(reward, agent.reward_over_time);
+        }
+        
+        cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
+        if (cJSON_IsArray(total_reward)) {
+            parse_timestamp_array(total_reward, agent.total_reward_over_time);
+        }
+    } else if (format == ReplayFormat::Objects) {
+        // objects format: "inventory" with item_id arrays
+        cJSON* inventory = cJSON_GetObjectItem(obj, "inventory");
+        if (cJSON_IsArray(inventory)) {
+            parse_objects_inventory(inventory, per_item, item_ids);
+        }
+        
+        // Parse reward data (different structure)
+        cJSON* current_reward = cJSON_GetObjectItem(obj, "current_reward");
+        if (cJSON_IsArray(current_reward)) {
+            parse_timestamp_array(current_reward, agent.reward_over_time);
+        }
+        
+        cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
+        if (cJSON_IsArray(total_reward)) {
+            parse_timestamp_array(total_reward, agent.total_reward_over_time);
+        }
+    }
+    
+    agent.set_inventory_columns(per_item);
+}
+
+bool ReplayParser::parse_json_data(const char* json_str, ReplayData& replay_data) {
+    cJSON* json = cJSON_Parse(json_str);
+    if (!json) return false;
+    
+    ReplayFormat format = parse_replay_header(json, replay_data);
+    std::vector<int> item_ids = intern_declared_items(format, replay_data);
+    
     // Parse agents from either format
     cJSON* objects_array = nullptr;
-    if (is_grid_objects_format) {
-        objects_array = cJSON_GetObjectItem(json, "grid_objects");
-    } else if (is_objects_format) {
+    if (format == ReplayFormat::Objects) {
         objects_array = cJSON_GetObjectItem(json, "objects");
+    } else if (format != ReplayFormat::Unknown) {
+        objects_array = cJSON_GetObjectItem(json, "grid_objects");
     }
     
     if (cJSON_IsArray(objects_array)) {
         cJSON* obj;
         cJSON_ArrayForEach(obj, objects_array) {
-            // Check for agent type in both formats
-            bool is_agent = false;
-            if (is_grid_objects_format) {
-                cJSON* type = cJSON_GetObjectItem(obj, "type");
-                is_agent = (cJSON_IsNumber(type) && cJSON_GetNumberValue(type) == 0);
-            } else if (is_objects_format) {
-                cJSON* type_id = cJSON_GetObjectItem(obj, "type_id");
-                is_agent = (cJSON_IsNumber(type_id) && cJSON_GetNumberValue(type_id) == 0);
-            }
-            
-            if (is_agent) {
+            if (is_agent_object(obj, format)) {
                 AgentInventoryState agent;
-                
-                cJSON* agent_id = cJSON_GetObjectItem(obj, "agent_id");
-                agent.agent_id = cJSON_IsNumber(agent_id) ? static_cast<int>(cJSON_GetNumberValue(agent_id)) : 0;
-                
-                // Parse location trajectory
-                cJSON* location = cJSON_GetObjectItem(obj, "location");
-                if (cJSON_IsArray(location)) {
-                    cJSON* loc_entry;
-                    cJSON_ArrayForEach(loc_entry, location) {
-                        if (cJSON_IsArray(loc_entry) && cJSON_GetArraySize(loc_entry) >= 2) {
-                            int timestep = static_cast<int>(cJSON_GetNumberValue(cJSON_GetArrayItem(loc_entry, 0)));
-                            cJSON* pos_array = cJSON_GetArrayItem(loc_entry, 1);
-                            
-                            Vector3 position = parse_location_array(pos_array);
-                            agent.location_over_time.push_back({timestep, position});
-                        }
-                    }
-                }
-                
-                std::cout << "Parsing agent " << agent.agent_id << " - format: " 
-                          << (is_pufferbox_format ? "pufferbox" : (is_objects_format ? "objects" : "grid_objects")) << std::endl;
-                
-                // Parse inventory data based on format
-                if (is_grid_objects_format && !is_pufferbox_format) {
-                    // grid_objects format: "inv:item_name" arrays
-                    for (const std::string& item : replay_data.inventory_items) {
-                        std::string inv_key = "inv:" + item;
-                        cJSON* inv_data = cJSON_GetObjectItem(obj, inv_key.c_str());
-                        if (cJSON_IsArray(inv_data)) {
-                            std::vector<TimestampValue> values;
-                            parse_timestamp_array(inv_data, values);
-                            agent.inventory_over_time[item] = values;
-                        }
-                    }
-                    
-                    // Parse reward data for grid_objects format
-                    cJSON* reward = cJSON_GetObjectItem(obj, "reward");
-                    if (cJSON_IsArray(reward)) {
-                        parse_timestamp_array(reward, agent.reward_over_time);
-                    }
-                    
-                    cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
-                    if (cJSON_IsArray(total_reward)) {
-                        parse_timestamp_array(total_reward, agent.total_reward_over_time);
-                    }
-                } else if (is_pufferbox_format) {
-                    // Pufferbox format with agent:inv: prefix and dots in names
-                    std::vector<std::string> agent_inv_items = {
-                        "ore.red", "ore.blue", "ore.green", 
-                        "battery", "heart", "armor", "laser", "blueprint"
-                    };
-                    for (const std::string& item : agent_inv_items) {
-                        std::string inv_key = "agent:inv:" + item;
-                        cJSON* inv_data = cJSON_GetObjectItem(obj, inv_key.c_str());
-                        if (inv_data && cJSON_IsArray(inv_data) && cJSON_GetArraySize(inv_data) > 0) {
-                            std::vector<TimestampValue> values;
-                            parse_timestamp_array(inv_data, values);
-                            // Convert dot notation to underscore for consistency
-                            std::string clean_item = item;
-                            std::replace(clean_item.begin(), clean_item.end(), '.', '_');
-                            agent.inventory_over_time[clean_item] = values;
-                        }
-                    }
-                    
-                    // Parse reward data
-                    cJSON* reward = cJSON_GetObjectItem(obj, "reward");
-                    if (cJSON_IsArray(reward)) {
-                        parse_timestamp_array(reward, agent.reward_over_time);
-                    }
-                    
-                    cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
-                    if (cJSON_IsArray(total_reward)) {
-                        parse_timestamp_array(total_reward, agent.total_reward_over_time);
-                    }
-                } else if (is_objects_format) {
-                    // objects format: "inventory" with item_id arrays
-                    cJSON* inventory = cJSON_GetObjectItem(obj, "inventory");
-                    if (cJSON_IsArray(inventory)) {
-                        parse_objects_inventory(inventory, agent, replay_data.inventory_items);
-                    }
-                    
-                    // Parse reward data (different structure)
-                    cJSON* current_reward = cJSON_GetObjectItem(obj, "current_reward");
-                    if (cJSON_IsArray(current_reward)) {
-                        parse_timestamp_array(current_reward, agent.reward_over_time);
-                    }
-                    
-                    cJSON* total_reward = cJSON_GetObjectItem(obj, "total_reward");
-                    if (cJSON_IsArray(total_reward)) {
-                        parse_timestamp_array(total_reward, agent.total_reward_over_time);
-                    }
-                }
-                
+                parse_agent_object(obj, format, replay_data.items.get(), replay_data.inventory_items, item_ids, agent);
+                agent.item_table = replay_data.items;
                 replay_data.add_agent(agent);
             }
         }
@@ -300,6 +670,206 @@ bool ReplayParser::parse_json_data(const char* json_str, ReplayData& replay_data
     return true;
 }
 
+// Minimal JSON scanning for the lazy index. These helpers only locate value
+// boundaries; nothing is decoded until an agent is requested.
+static size_t skip_json_ws(std::string_view text, size_t pos) {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    return pos;
+}
+
+static size_t skip_json_string(std::string_view text, size_t pos) {
+    for (pos++; pos < text.size(); pos++) {
+        if (text[pos] == '\\') pos++;
+        else if (text[pos] == '"') return pos + 1;
+    }
+    return text.size();
+}
+
+static size_t skip_json_value(std::string_view text, size_t pos) {
+    if (pos >= text.size()) return pos;
+    char c = text[pos];
+    if (c == '"') return skip_json_string(text, pos);
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        while (pos < text.size()) {
+            c = text[pos];
+            if (c == '"') {
+                pos = skip_json_string(text, pos);
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') {
+                if (--depth == 0) return pos + 1;
+            }
+            pos++;
+        }
+        return pos;
+    }
+    // Number or literal
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' &&
+           !std::isspace(static_cast<unsigned char>(text[pos]))) {
+        pos++;
+    }
+    return pos;
+}
+
+// Call fn(value_begin, value_end) for each element of the array at [begin, end)
+template <typename Fn>
+static void for_each_json_element(std::string_view text, size_t begin, size_t end, Fn&& fn) {
+    size_t pos = skip_json_ws(text, begin);
+    if (pos >= end || text[pos] != '[') return;
+    pos = skip_json_ws(text, pos + 1);
+    while (pos < end && text[pos] != ']') {
+        size_t value_end = skip_json_value(text, pos);
+        fn(pos, value_end);
+        pos = skip_json_ws(text, value_end);
+        if (pos < end && text[pos] == ',') pos = skip_json_ws(text, pos + 1);
+    }
+}
+
+// Call fn(key, value_begin, value_end) for each member of the object at [begin, end)
+template <typename Fn>
+static void for_each_json_member(std::string_view text, size_t begin, size_t end, Fn&& fn) {
+    size_t pos = skip_json_ws(text, begin);
+    if (pos >= end || text[pos] != '{') return;
+    pos = skip_json_ws(text, pos + 1);
+    while (pos < end && text[pos] == '"') {
+        size_t key_end = skip_json_string(text, pos);
+        std::string key(text.substr(pos + 1, key_end - pos - 2));
+        pos = skip_json_ws(text, key_end);
+        if (pos >= end || text[pos] != ':') return;
+        pos = skip_json_ws(text, pos + 1);
+        size_t value_end = skip_json_value(text, pos);
+        fn(key, pos, value_end);
+        pos = skip_json_ws(text, value_end);
+        if (pos < end && text[pos] == ',') pos = skip_json_ws(text, pos + 1);
+    }
+}
+
+bool ReplayParser::open_replay_lazy(const std::string& filename, bool compressed, ReplayData& replay_data,
+                                    size_t cache_capacity) {
+    // Compressed replays are inflated to a temporary file so agents can still
+    // be read back by offset
+    FILE* file = compressed ? decompress_zlib_file(filename.c_str()) : std::fopen(filename.c_str(), "rb");
+    if (!file) return false;
+    auto source = std::make_shared<LazyAgentSource>();
+    source->file = file;
+    source->capacity = cache_capacity;
+    
+    // Index through a temporary mapping; only the byte ranges outlive it
+    size_t size = 0;
+    const char* data = map_file(file, &size);
+    if (!data) return false;
+    bool indexed = index_json_data(std::string_view(data, size), *source, replay_data);
+    unmap_file(data, size);
+    if (!indexed) return false;
+    
+    std::cout << "Indexed " << source->entries.size() << " agents (" << format_name(source->format)
+              << " format) for lazy loading, cache capacity " << source->capacity << std::endl;
+    replay_data.lazy_source = source;
+    return true;
+}
+
+// strtod for a value inside the mapped text, which is not NUL-terminated
+static double parse_json_number(std::string_view text, size_t begin, size_t end) {
+    char buffer[64];
+    size_t length = std::min(end - begin, sizeof(buffer) - 1);
+    std::memcpy(buffer, text.data() + begin, length);
+    buffer[length] = '\0';
+    return std::strtod(buffer, nullptr);
+}
+
+bool ReplayParser::index_json_data(std::string_view json, LazyAgentSource& source, ReplayData& replay_data) {
+    // Locate the header arrays and the object list at the top level
+    std::string header = "{";
+    size_t objects_begin = 0, objects_end = 0;
+    bool has_objects = false;
+    for_each_json_member(json, 0, json.size(), [&](const std::string& key, size_t begin, size_t end) {
+        if (key == "inventory_items" || key == "item_names" || key == "object_types" || key == "type_names") {
+            header += "\"" + key + "\":" + std::string(json.substr(begin, end - begin)) + ",";
+        } else if (key == "grid_objects" || key == "objects") {
+            if (!has_objects || key == "grid_objects") {
+                header += "\"" + key + "\":[],";
+                objects_begin = begin;
+                objects_end = end;
+                has_objects = true;
+            }
+        }
+    });
+    if (!has_objects) return false;
+    header.back() = '}';
+    
+    // Reuse the eager header logic on the (small) reconstructed header
+    cJSON* header_json = cJSON_Parse(header.c_str());
+    if (!header_json) return false;
+    source.format = parse_replay_header(header_json, replay_data);
+    cJSON_Delete(header_json);
+    source.item_ids = intern_declared_items(source.format, replay_data);
+    
+    // Record each agent's byte range and scan its location timesteps for
+    // max_timestep. Pufferbox items are interned here, in the same order the
+    // eager parser would meet them, so decoding never has to add names.
+    const char* type_key = source.format == ReplayFormat::Objects ? "type_id" : "type";
+    const std::vector<std::string>& pufferbox_items = pufferbox_inventory_items();
+    const std::string pufferbox_prefix = "agent:inv:";
+    replay_data.max_timestep = 0;
+    for_each_json_element(json, objects_begin, objects_end, [&](size_t obj_begin, size_t obj_end) {
+        bool is_agent = false;
+        int agent_id = 0;
+        int max_timestep = 0;
+        std::vector<bool> has_item(pufferbox_items.size(), false);
+        for_each_json_member(json, obj_begin, obj_end, [&](const std::string& key, size_t begin, size_t end) {
+            if (source.format == ReplayFormat::Pufferbox && key.compare(0, pufferbox_prefix.size(), pufferbox_prefix) == 0) {
+                // Only non-empty arrays count, as in parse_agent_object
+                size_t first = begin < end && json[begin] == '[' ? skip_json_ws(json, begin + 1) : end;
+                if (first >= end || json[first] == ']') return;
+                auto item = std::find(pufferbox_items.begin(), pufferbox_items.end(), key.substr(pufferbox_prefix.size()));
+                if (item != pufferbox_items.end()) has_item[item - pufferbox_items.begin()] = true;
+            } else if (key == type_key) {
+                is_agent = parse_json_number(json, begin, end) == 0.0 && std::isdigit(static_cast<unsigned char>(json[begin]));
+            } else if (key == "agent_id") {
+                agent_id = static_cast<int>(parse_json_number(json, begin, end));
+            } else if (key == "location") {
+                for_each_json_element(json, begin, end, [&](size_t entry_begin, size_t) {
+                    size_t pos = skip_json_ws(json, entry_begin + 1);
+                    int timestep = static_cast<int>(parse_json_number(json, pos, skip_json_value(json, pos)));
+                    max_timestep = std::max(max_timestep, timestep);
+                });
+            }
+        });
+        if (!is_agent) return;
+        
+        for (size_t i = 0; i < pufferbox_items.size(); i++) {
+            if (has_item[i]) replay_data.items->intern(pufferbox_item_name(pufferbox_items[i]));
+        }
+        replay_data.max_timestep = std::max(replay_data.max_timestep, max_timestep);
+        if (source.entry_by_id.count(agent_id) == 0) {
+            source.entry_by_id[agent_id] = source.entries.size();
+        }
+        source.entries.push_back(LazyAgentEntry{agent_id, obj_begin, obj_end});
+    });
+    
+    if (source.format == ReplayFormat::Pufferbox) {
+        // -1 for items no agent carries
+        for (const std::string& item : pufferbox_items) {
+            source.item_ids.push_back(replay_data.items->find(pufferbox_item_name(item)));
+        }
+    }
+    return true;
+}
+
+bool ReplayParser::decode_lazy_agent(const LazyAgentSource& source, const LazyAgentEntry& entry,
+                                     const std::vector<std::string>& inventory_items, AgentInventoryState& agent) {
+    std::vector<char> text(entry.end - entry.begin);
+    if (!read_file_range(source.file, entry.begin, text.size(), text.data())) return false;
+    cJSON* obj = cJSON_ParseWithLength(text.data(), text.size());
+    if (!obj) return false;
+    
+    parse_agent_object(obj, source.format, nullptr, inventory_items, source.item_ids, agent);
+    cJSON_Delete(obj);
+    return true;
+}
+
 void ReplayParser::parse_timestamp_array(cJSON* array, std::vector<TimestampValue>& output) {
     if (!cJSON_IsArray(array)) return;
     
@@ -313,8 +883,8 @@ void ReplayParser::parse_timestamp_array(cJSON* array, std::vector<TimestampValu
     }
 }
 
-void ReplayParser::parse_objects_inventory(cJSON* inventory_array, AgentInventoryState& agent, 
-                                          const std::vector<std::string>& item_names) {
+void ReplayParser::parse_objects_inventory(cJSON* inventory_array, std::vector<std::vector<TimestampValue>>& per_item,
+                                          const std::vector<int>& item_ids) {
     if (!cJSON_IsArray(inventory_array)) {
         std::cout << "ERROR: objects inventory is not an array!" << std::endl;
         return;
@@ -323,9 +893,9 @@ void ReplayParser::parse_objects_inventory(cJSON* inventory_array, AgentInventor
     std::cout << "Parsing objects inventory with " << cJSON_GetArraySize(inventory_array) << " entries" << std::endl;
     
     // Initialize inventory tracking for all items
-    for (const std::string& item : item_names) {
-        agent.inventory_over_time[item] = std::vector<TimestampValue>();
-    }
+    int max_id = -1;
+    for (int id : item_ids) max_id = std::max(max_id, id);
+    if (static_cast<int>(per_item.size()) <= max_id) per_item.resize(max_id + 1);
     
     cJSON* inv_entry;
     cJSON_ArrayForEach(inv_entry, inventory_array) {
@@ -341,13 +911,12 @@ void ReplayParser::parse_objects_inventory(cJSON* inventory_array, AgentInventor
         cJSON_ArrayForEach(item_entry, items_array) {
             if (!cJSON_IsArray(item_entry) || cJSON_GetArraySize(item_entry) < 2) continue;
             
-            int item_id = static_cast<int>(cJSON_GetNumberValue(cJSON_GetArrayItem(item_entry, 0)));
+            int item_index = static_cast<int>(cJSON_GetNumberValue(cJSON_GetArrayItem(item_entry, 0)));
             float quantity = static_cast<float>(cJSON_GetNumberValue(cJSON_GetArrayItem(item_entry, 1)));
             
-            // Map item_id to item name
-            if (item_id >= 0 && item_id < static_cast<int>(item_names.size())) {
-                const std::string& item_name = item_names[item_id];
-                agent.inventory_over_time[item_name].emplace_back(timestep, quantity);
+            // Map file item index to interned item id
+            if (item_index >= 0 && item_index < static_cast<int>(item_ids.size())) {
+                per_item[item_ids[item_index]].emplace_back(timestep, quantity);
             }
         }
     }
@@ -370,202 +939,551 @@ Vector3 ReplayParser::parse_location_array(cJSON* location_array) {
 }
 
 // AgentGraphBuilder methods
-void AgentGraphBuilder::build_inventory_dimensional_graph(const ReplayData& replay, Graph3D& graph3d, 
-                                                          const std::vector<std::string>& inventory_dims) {
-    std::cout << "Building agent state space graph (nodes = unique inventory states)\n";
+// Sweep an agent's change events in timestep order, starting after
+// after_timestep. The per-item series and the total reward series are merged
+// through a min-heap keyed on each series' next timestep; fn(timestep,
+// item_values, total_reward) runs once per distinct timestep after every event
+// at that timestep has been applied. Each event is read once and only series
+// with an event at a timestep are touched, so a sweep costs
+// O(events log series) however sparse the items are.
+template <typename Fn>
+static void sweep_agent_events(const AgentInventoryState& agent, int after_timestep, Fn&& fn) {
+    size_t items = agent.item_count();
+    const auto& totals = agent.total_reward_over_time;
+    std::vector<uint32_t> pos(items);
+    std::vector<float> item_values(items, 0.0f);
     
-    // Create nodes for unique inventory state combinations
-    std::map<std::string, uint32_t> state_to_node_id;
-    std::vector<std::string> node_id_to_state;
+    // (next timestep, series) with series == items standing for the total reward
+    std::vector<std::pair<int, uint32_t>> heap;
+    heap.reserve(items + 1);
+    for (size_t i = 0; i < items; i++) {
+        const int* begin = agent.inv_timesteps.data() + agent.item_offsets[i];
+        const int* end = agent.inv_timesteps.data() + agent.item_ends[i];
+        uint32_t p = static_cast<uint32_t>(std::upper_bound(begin, end, after_timestep) - agent.inv_timesteps.data());
+        if (p > agent.item_offsets[i]) item_values[i] = agent.inv_values[p - 1];
+        pos[i] = p;
+        if (p < agent.item_ends[i]) heap.emplace_back(agent.inv_timesteps[p], static_cast<uint32_t>(i));
+    }
     
-    // Find all unique inventory state combinations across all agents and timesteps
-    for (const auto& agent : replay.agents) {
-        // Sample key timesteps for this agent
-        std::vector<int> key_timesteps;
-        for (const auto& [item, values] : agent.inventory_over_time) {
-            for (const auto& tv : values) {
-                key_timesteps.push_back(tv.timestep);
+    auto first_total = std::upper_bound(totals.begin(), totals.end(), after_timestep,
+                                        [](int t, const TimestampValue& tv) { return t < tv.timestep; });
+    size_t total_pos = static_cast<size_t>(first_total - totals.begin());
+    float total_reward = total_pos > 0 ? totals[total_pos - 1].value : 0.0f;
+    if (total_pos < totals.size()) heap.emplace_back(totals[total_pos].timestep, static_cast<uint32_t>(items));
+    
+    auto later = std::greater<std::pair<int, uint32_t>>();
+    std::make_heap(heap.begin(), heap.end(), later);
+    while (!heap.empty()) {
+        int timestep = heap.front().first;
+        while (!heap.empty() && heap.front().first == timestep) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            uint32_t series = heap.back().second;
+            heap.pop_back();
+            
+            bool more;
+            int next = 0;
+            if (series < items) {
+                uint32_t end = agent.item_ends[series];
+                uint32_t& p = pos[series];
+                while (p < end && agent.inv_timesteps[p] == timestep) item_values[series] = agent.inv_values[p++];
+                more = p < end;
+                if (more) next = agent.inv_timesteps[p];
+            } else {
+                while (total_pos < totals.size() && totals[total_pos].timestep == timestep) {
+                    total_reward = totals[total_pos++].value;
+                }
+                more = total_pos < totals.size();
+                if (more) next = totals[total_pos].timestep;
+            }
+            if (more) {
+                heap.emplace_back(next, series);
+                std::push_heap(heap.begin(), heap.end(), later);
             }
         }
         
-        // Add reward change timesteps
+        fn(timestep, item_values, total_reward);
+    }
+}
+
+// Run fn(worker, agent_index) over agents on worker_count threads. Each worker
+// takes an interleaved subset of agents, in increasing index order.
+template <typename Fn>
+static void for_each_agent_parallel(size_t agent_count, unsigned worker_count, Fn&& fn) {
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < worker_count; w++) {
+        workers.emplace_back([&, w]() {
+            for (size_t a = w; a < agent_count; a += worker_count) fn(w, a);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+// Serial sweep order of an event: agent first, then timestep. Parallel
+// builders renumber states and transitions by this to stay deterministic.
+static uint64_t sweep_order(size_t agent_index, int timestep) {
+    return static_cast<uint64_t>(agent_index) << 32 | (static_cast<uint32_t>(timestep) ^ 0x80000000u);
+}
+
+static int sweep_order_timestep(uint64_t order) {
+    return static_cast<int>(static_cast<uint32_t>(order) ^ 0x80000000u);
+}
+
+std::vector<int> AgentGraphBuilder::resolve_state_dims(const ReplayData& replay, const StateSpec& spec) {
+    // Resolve dimension names to item ids once; unknown items map to -1
+    std::vector<int> dim_ids;
+    for (const auto& dim : spec.dims) {
+        dim_ids.push_back(dim.item == "time" ? TIME_DIMENSION : replay.item_id(dim.item));
+    }
+    return dim_ids;
+}
+
+StateKeyLayout AgentGraphBuilder::fit_state_key_layout(const ReplayData& replay, const StateSpec& spec,
+                                                       const std::vector<int>& dim_ids, unsigned worker_count) {
+    // Observed raw range of every field (dimensions, then reward); 0 is always
+    // included since that is the value before an agent's first event. Binning
+    // is monotonic, so the bins of the range ends bound every field.
+    using Ranges = std::vector<std::pair<float, float>>;
+    auto widen = [](std::pair<float, float>& range, float value) {
+        range.first = std::min(range.first, value);
+        range.second = std::max(range.second, value);
+    };
+    
+    worker_count = std::max(1u, worker_count);
+    std::vector<Ranges> worker_ranges(worker_count, Ranges(dim_ids.size() + 1, {0, 0}));
+    for_each_agent_parallel(replay.agents.size(), worker_count, [&](unsigned worker, size_t agent_index) {
+        const auto& agent = replay.agents[agent_index];
+        Ranges& ranges = worker_ranges[worker];
+        for (size_t d = 0; d < dim_ids.size(); d++) {
+            if (dim_ids[d] == TIME_DIMENSION) {
+                for (size_t i = 0; i < agent.item_count(); i++) {
+                    InventorySeries series = agent.inventory_series(static_cast<int>(i));
+                    for (size_t k = 0; k < series.size; k++) widen(ranges[d], static_cast<float>(series.timesteps[k]));
+                }
+                for (const auto& tv : agent.total_reward_over_time) widen(ranges[d], static_cast<float>(tv.timestep));
+            } else {
+                InventorySeries series = agent.inventory_series(dim_ids[d]);
+                for (size_t i = 0; i < series.size; i++) widen(ranges[d], series.values[i]);
+            }
+        }
         for (const auto& tv : agent.total_reward_over_time) {
-            key_timesteps.push_back(tv.timestep);
+            widen(ranges.back(), tv.value);
+        }
+    });
+    
+    StateKeyLayout layout;
+    for (size_t field = 0; field <= dim_ids.size(); field++) {
+        std::pair<float, float> range = {0.0f, 0.0f};
+        for (const Ranges& ranges : worker_ranges) {
+            widen(range, ranges[field].first);
+            widen(range, ranges[field].second);
         }
+        const StateDimensionSpec& binning = field < dim_ids.size() ? spec.dims[field] : spec.reward;
+        layout.add_field(binning.bin(range.first), binning.bin(range.second));
+    }
+    return layout;
+}
+
+StateKey AgentGraphBuilder::make_state_key(const StateKeyLayout& layout, const StateSpec& spec,
+                                           const std::vector<int>& dim_ids, const std::vector<float>& quantities,
+                                           int timestep, int reward_bucket, bool* clamped) {
+    StateKey key;
+    bool exact = true;
+    for (size_t d = 0; d < dim_ids.size(); d++) {
+        float value = dim_ids[d] == TIME_DIMENSION ? static_cast<float>(timestep) : quantities[d];
+        exact &= layout.set(key, d, spec.dims[d].bin(value));
+    }
+    exact &= layout.set(key, dim_ids.size(), reward_bucket);
+    if (clamped && !exact) *clamped = true;
+    return key;
+}
+
+uint32_t AgentGraphBuilder::add_state_node(Graph3D& graph3d, const StateSpec& spec,
+                                           const std::vector<float>& quantities, float total_reward,
+                                           int reward_bucket, int timestep, bool verbose) {
+    // Smart initialization based on inventory state properties
+    float ore_qty = 0, battery_qty = 0, heart_qty = 0;
+    for (size_t d = 0; d < spec.dims.size(); d++) {
+        const std::string& item = spec.dims[d].item;
+        if (item == "ore_red") ore_qty = quantities[d];
+        else if (item == "battery_red") battery_qty = quantities[d];
+        else if (item == "heart") heart_qty = quantities[d];
+    }
+    
+    // Initialize in organized grid pattern with reward/temporal Z-dimension
+    // Calculate Z based on reward progression over time
+    float max_reward_in_data = 20.0f; // Reasonable max for scaling
+    float reward_z = (total_reward / max_reward_in_data) * 10.0f; // Scale to reasonable Z range
+    
+    // Add temporal component - later timesteps get pushed forward
+    float max_timestep = 1000.0f; // Reasonable max timestep
+    float temporal_z = (static_cast<float>(timestep) / max_timestep) * 5.0f;
+    
+    Vector3 position(
+        (ore_qty - 5.0f) * 2.0f,        // X: Center around 5 ore (typical mid-range)
+        (battery_qty - 1.0f) * 3.0f,    // Y: Center around 1 battery  
+        reward_z + temporal_z - 7.5f    // Z: Reward + time progression, centered around -7.5
+    );
+    
+    // DEBUG: Print first few positions to compare formats
+    if (verbose && graph3d.node_count < 5) {
+        std::cout << "Initial node " << graph3d.node_count << " position: (" 
+                  << position.x << "," << position.y << "," << position.z 
+                  << ") from inventory: ore=" << ore_qty << " battery=" << battery_qty << " heart=" << heart_qty
+                  << " reward=" << total_reward << " timestep=" << timestep << std::endl;
+    }
+    
+    Color color = reward_to_color(total_reward, MAX_REWARD_FOR_COLOR); // Use actual reward value, not bucket
+    float node_radius = 0.3f + static_cast<float>(reward_bucket) * 0.1f;
+    
+    // DEBUG: Print color assignment for first few states
+    static int debug_count = 0;
+    if (verbose && debug_count < 5) {
+        std::cout << "State with reward " << reward_bucket << " gets color: (" 
+                  << (int)color.r << "," << (int)color.g << "," << (int)color.b << ")" << std::endl;
+        debug_count++;
+    }
+    
+    std::string label = "State_R" + std::to_string(reward_bucket);
+    return graph3d.add_node(position, color, node_radius, label);
+}
+
+Color AgentGraphBuilder::transition_color(int from_reward, int to_reward) {
+    // Color edges based on reward change
+    if (to_reward > from_reward) {
+        return Color(100, 255, 100, 255); // Green for reward increase
+    } else if (to_reward < from_reward) {
+        return Color(255, 100, 100, 255); // Red for reward decrease
+    }
+    return GRAY; // Gray for no reward change
+}
+
+// Signed log2 bins, offset and clamped into [0, STAT_BINS), for the
+// item/reward joint histograms
+static constexpr int STAT_BINS = 16;
+
+static int statistics_bin(float value) {
+    static const StateDimensionSpec log_bins = [] {
+        StateDimensionSpec spec;
+        spec.binning = StateDimensionSpec::Binning::Log;
+        return spec;
+    }();
+    return std::max(0, std::min(STAT_BINS - 1, log_bins.bin(value) + STAT_BINS / 2));
+}
+
+std::vector<ItemStatistics> AgentGraphBuilder::compute_item_statistics(const ReplayData& replay, unsigned thread_count) {
+    size_t item_count = replay.items->size();
+    size_t agent_count = replay.agents.size();
+    int horizon = replay.max_timestep + 1;
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    unsigned worker_count = std::max(1u, std::min(thread_count, static_cast<unsigned>(agent_count)));
+    
+    struct Accumulator {
+        std::vector<double> weight, sum, sum_sq;
+        std::vector<uint64_t> changes;
+        std::vector<double> joint; // item_count x STAT_BINS (item) x STAT_BINS (reward), time-weighted
+    };
+    std::vector<Accumulator> workers(worker_count);
+    for (Accumulator& acc : workers) {
+        acc.weight.assign(item_count, 0.0);
+        acc.sum.assign(item_count, 0.0);
+        acc.sum_sq.assign(item_count, 0.0);
+        acc.changes.assign(item_count, 0);
+        acc.joint.assign(item_count * STAT_BINS * STAT_BINS, 0.0);
+    }
+    
+    for_each_agent_parallel(agent_count, worker_count, [&](unsigned worker, size_t agent_index) {
+        const AgentInventoryState& agent = replay.agents[agent_index];
+        const auto& rewards = agent.total_reward_over_time;
+        Accumulator& acc = workers[worker];
         
-        // Remove duplicates and sort
-        std::sort(key_timesteps.begin(), key_timesteps.end());
-        key_timesteps.erase(std::unique(key_timesteps.begin(), key_timesteps.end()), key_timesteps.end());
+        // Time spent in each reward bin, for the items this agent never holds
+        double reward_time[STAT_BINS] = {};
+        bool have_reward_time = false;
         
-        // Create nodes for each unique state
-        for (int timestep : key_timesteps) {
-            // Create state signature
-            std::string state_sig = "";
-            for (const std::string& item : inventory_dims) {
-                if (item == "time") {
-                    state_sig += "T" + std::to_string(timestep / 100) + "_"; // Coarse time buckets
-                } else {
-                    int qty = static_cast<int>(agent.get_inventory_at_time(item, timestep));
-                    state_sig += item + std::to_string(qty) + "_";
+        for (size_t item = 0; item < item_count; item++) {
+            InventorySeries series = agent.inventory_series(static_cast<int>(item));
+            float last_value = 0.0f;
+            for (size_t i = 0; i < series.size; i++) {
+                if (series.values[i] != last_value) acc.changes[item]++;
+                last_value = series.values[i];
+            }
+            double* joint = acc.joint.data() + item * STAT_BINS * STAT_BINS;
+            if (series.empty()) {
+                // Constantly 0: the whole horizon sits in the zero bin, spread
+                // over the reward bins like any other time at value 0
+                if (!have_reward_time) {
+                    float reward_value = 0.0f;
+                    size_t r = 0;
+                    for (int t = 0; t < horizon;) {
+                        while (r < rewards.size() && rewards[r].timestep <= t) reward_value = rewards[r++].value;
+                        int next = r < rewards.size() ? std::min(horizon, rewards[r].timestep) : horizon;
+                        reward_time[statistics_bin(reward_value)] += static_cast<double>(next - t);
+                        t = next;
+                    }
+                    have_reward_time = true;
                 }
+                acc.weight[item] += std::max(horizon, 0);
+                for (int y = 0; y < STAT_BINS; y++) joint[statistics_bin(0.0f) * STAT_BINS + y] += reward_time[y];
+                continue;
             }
-            float total_reward = agent.get_total_reward_at_time(timestep);
-            int reward_bucket = static_cast<int>(total_reward * REWARD_BUCKET_SCALE); // Scale up for better bucketing
-            state_sig += "R" + std::to_string(reward_bucket);
             
-            // Add node if this state is new
-            if (state_to_node_id.find(state_sig) == state_to_node_id.end()) {
-                // Smart initialization based on inventory state properties
-                float ore_qty = 0, battery_qty = 0, heart_qty = 0;
-                for (const std::string& item : inventory_dims) {
-                    if (item == "ore_red") ore_qty = agent.get_inventory_at_time(item, timestep);
-                    else if (item == "battery_red") battery_qty = agent.get_inventory_at_time(item, timestep);
-                    else if (item == "heart") heart_qty = agent.get_inventory_at_time(item, timestep);
-                }
-                
-                // Initialize in organized grid pattern with reward/temporal Z-dimension
-                // Calculate Z based on reward progression over time
-                float max_reward_in_data = 20.0f; // Reasonable max for scaling
-                float reward_z = (total_reward / max_reward_in_data) * 10.0f; // Scale to reasonable Z range
-                
-                // Add temporal component - later timesteps get pushed forward
-                float max_timestep = 1000.0f; // Reasonable max timestep
-                float temporal_z = (static_cast<float>(timestep) / max_timestep) * 5.0f;
-                
-                Vector3 position(
-                    (ore_qty - 5.0f) * 2.0f,        // X: Center around 5 ore (typical mid-range)
-                    (battery_qty - 1.0f) * 3.0f,    // Y: Center around 1 battery  
-                    reward_z + temporal_z - 7.5f    // Z: Reward + time progression, centered around -7.5
-                );
+            // Walk the item and reward series together; each piece of time
+            // where both are constant adds its length as weight
+            float item_value = 0.0f, reward_value = 0.0f;
+            size_t i = 0, r = 0;
+            for (int t = 0; t < horizon;) {
+                while (i < series.size && series.timesteps[i] <= t) item_value = series.values[i++];
+                while (r < rewards.size() && rewards[r].timestep <= t) reward_value = rewards[r++].value;
+                int next = horizon;
+                if (i < series.size) next = std::min(next, series.timesteps[i]);
+                if (r < rewards.size()) next = std::min(next, rewards[r].timestep);
                 
-                // DEBUG: Print first few positions to compare formats
-                if (state_to_node_id.size() < 5) {
-                    std::cout << "Initial node " << state_to_node_id.size() << " position: (" 
-                              << position.x << "," << position.y << "," << position.z 
-                              << ") from inventory: ore=" << ore_qty << " battery=" << battery_qty << " heart=" << heart_qty
-                              << " reward=" << total_reward << " timestep=" << timestep << std::endl;
-                }
-                
-                Color color = reward_to_color(total_reward, MAX_REWARD_FOR_COLOR); // Use actual reward value, not bucket
-                float node_radius = 0.3f + static_cast<float>(reward_bucket) * 0.1f;
-                
-                // DEBUG: Print color assignment for first few states
-                static int debug_count = 0;
-                if (debug_count < 5) {
-                    std::cout << "State with reward " << reward_bucket << " gets color: (" 
-                              << (int)color.r << "," << (int)color.g << "," << (int)color.b << ")" << std::endl;
-                    debug_count++;
-                }
-                
-                std::string label = "State_R" + std::to_string(reward_bucket);
-                uint32_t node_id = graph3d.add_node(position, color, node_radius, label);
-                
-                state_to_node_id[state_sig] = node_id;
-                node_id_to_state.push_back(state_sig);
+                double w = static_cast<double>(next - t);
+                acc.weight[item] += w;
+                acc.sum[item] += w * item_value;
+                acc.sum_sq[item] += w * item_value * item_value;
+                joint[statistics_bin(item_value) * STAT_BINS + statistics_bin(reward_value)] += w;
+                t = next;
             }
         }
-    }
+    });
     
-    // Create edges based on actual temporal agent transitions
-    std::map<std::pair<std::string, std::string>, int> transition_count;
-    
-    // Track agent state transitions over time
-    for (const auto& agent : replay.agents) {
-        std::vector<int> key_timesteps;
+    std::vector<ItemStatistics> stats(item_count);
+    std::vector<double> joint(STAT_BINS * STAT_BINS);
+    for (size_t item = 0; item < item_count; item++) {
+        ItemStatistics& stat = stats[item];
+        stat.item = replay.item_name(static_cast<int>(item));
+        
+        double weight = 0.0, sum = 0.0, sum_sq = 0.0;
+        std::fill(joint.begin(), joint.end(), 0.0);
+        for (const Accumulator& acc : workers) {
+            weight += acc.weight[item];
+            sum += acc.sum[item];
+            sum_sq += acc.sum_sq[item];
+            stat.change_count += acc.changes[item];
+            const double* worker_joint = acc.joint.data() + item * STAT_BINS * STAT_BINS;
+            for (int b = 0; b < STAT_BINS * STAT_BINS; b++) joint[b] += worker_joint[b];
+        }
+        if (weight <= 0.0) continue;
         
-        // Get all timesteps where inventory changes
-        for (const auto& [item, values] : agent.inventory_over_time) {
-            for (const auto& tv : values) {
-                key_timesteps.push_back(tv.timestep);
+        stat.mean = sum / weight;
+        stat.variance = std::max(0.0, sum_sq / weight - stat.mean * stat.mean);
+        
+        // I(X; Y) = sum p(x, y) log2(p(x, y) / (p(x) p(y)))
+        double item_marginal[STAT_BINS] = {}, reward_marginal[STAT_BINS] = {};
+        for (int x = 0; x < STAT_BINS; x++) {
+            for (int y = 0; y < STAT_BINS; y++) {
+                item_marginal[x] += joint[x * STAT_BINS + y] / weight;
+                reward_marginal[y] += joint[x * STAT_BINS + y] / weight;
             }
         }
-        for (const auto& tv : agent.total_reward_over_time) {
-            key_timesteps.push_back(tv.timestep);
+        for (int x = 0; x < STAT_BINS; x++) {
+            for (int y = 0; y < STAT_BINS; y++) {
+                double p = joint[x * STAT_BINS + y] / weight;
+                if (p > 0.0) stat.reward_information += p * std::log2(p / (item_marginal[x] * reward_marginal[y]));
+            }
         }
+    }
+    return stats;
+}
+
+std::vector<std::string> AgentGraphBuilder::select_state_items(const ReplayData& replay, size_t k, unsigned thread_count) {
+    std::vector<ItemStatistics> stats = compute_item_statistics(replay, thread_count);
+    
+    // Items that never change carry no state; rank the rest by what they tell
+    // about reward, then by spread and activity
+    std::vector<const ItemStatistics*> ranked;
+    for (const auto& stat : stats) {
+        if (stat.change_count > 0 && stat.variance > 0.0) ranked.push_back(&stat);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const ItemStatistics* a, const ItemStatistics* b) {
+        if (a->reward_information != b->reward_information) return a->reward_information > b->reward_information;
+        if (a->variance != b->variance) return a->variance > b->variance;
+        return a->change_count > b->change_count;
+    });
+    
+    std::cout << "Item statistics (" << ranked.size() << " of " << stats.size() << " items change):\n";
+    for (size_t i = 0; i < ranked.size() && i < 8; i++) {
+        std::cout << "  " << ranked[i]->item << ": reward MI=" << ranked[i]->reward_information
+                  << " bits, variance=" << ranked[i]->variance << ", changes=" << ranked[i]->change_count << "\n";
+    }
+    
+    std::vector<std::string> selected;
+    for (size_t i = 0; i < ranked.size() && i < k; i++) selected.push_back(ranked[i]->item);
+    
+    std::cout << "Selected state dimensions:";
+    for (const auto& item : selected) std::cout << " " << item;
+    std::cout << (selected.empty() ? " none" : "") << std::endl;
+    return selected;
+}
+
+void AgentGraphBuilder::build_inventory_dimensional_graph(const ReplayData& replay, Graph3D& graph3d, 
+                                                          const std::vector<std::string>& inventory_dims,
+                                                          unsigned thread_count) {
+    build_inventory_dimensional_graph(replay, graph3d, StateSpec::from_items(inventory_dims), thread_count);
+}
+
+void AgentGraphBuilder::build_inventory_dimensional_graph(const ReplayData& replay, Graph3D& graph3d,
+                                                          const StateSpec& spec, unsigned thread_count) {
+    std::cout << "Building agent state space graph (nodes = unique inventory states)\n";
+    std::cout << "State spec: " << spec.describe() << "\n";
+    
+    std::vector<int> dim_ids = resolve_state_dims(replay, spec);
+    size_t agent_count = replay.agents.size();
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    unsigned worker_count = std::max(1u, std::min(thread_count, static_cast<unsigned>(agent_count)));
+    
+    // States are packed integer keys: one bit field per dimension plus the reward bucket
+    StateKeyLayout layout = fit_state_key_layout(replay, spec, dim_ids, worker_count);
+    if (layout.field_count() != dim_ids.size() + 1) {
+        std::cerr << "State dimensions do not fit in a " << StateKeyLayout::MAX_BITS << "-bit key\n";
+        return;
+    }
+    size_t reward_field = dim_ids.size();
+    std::cout << "State keys use " << layout.bits_used() << " bits, " << worker_count << " worker threads\n";
+    
+    // Workers sweep their agents' merged change events. Each distinct timestep
+    // interns the agent's state in the shared sharded table (which keeps the
+    // state's earliest sweep order) and counts the transition into it in the
+    // worker's own table.
+    struct TransitionTally {
+        uint32_t from_state;
+        uint32_t to_state;
+        int count;
+        uint64_t first_seen;
+    };
+    struct WorkerState {
+        StateKeyTable seen_states;       // local cache of shared state ids
+        StateKeyTable transition_index;  // (from, to) -> tallies index
+        std::vector<TransitionTally> tallies;
+        std::vector<float> quantities;
+    };
+    ShardedStateKeyTable shared_states;
+    std::vector<WorkerState> worker_states(worker_count);
+    
+    for_each_agent_parallel(agent_count, worker_count, [&](unsigned worker, size_t agent_index) {
+        WorkerState& local = worker_states[worker];
+        local.quantities.assign(dim_ids.size(), 0.0f);
+        uint32_t current_state = UINT32_MAX;
         
-        // Sort and remove duplicates
-        std::sort(key_timesteps.begin(), key_timesteps.end());
-        key_timesteps.erase(std::unique(key_timesteps.begin(), key_timesteps.end()), key_timesteps.end());
-        
-        // Create state signatures for consecutive timesteps
-        for (size_t t = 0; t < key_timesteps.size() - 1; t++) {
-            int current_time = key_timesteps[t];
-            int next_time = key_timesteps[t + 1];
-            
-            // Generate state signatures for current and next states
-            auto create_state_sig = [&](int timestep) -> std::string {
-                std::string sig = "";
-                for (const std::string& item : inventory_dims) {
-                    if (item == "time") {
-                        sig += "T" + std::to_string(timestep / 100) + "_";
-                    } else {
-                        int qty = static_cast<int>(agent.get_inventory_at_time(item, timestep));
-                        sig += item + std::to_string(qty) + "_";
-                    }
-                }
-                int reward_bucket = static_cast<int>(agent.get_total_reward_at_time(timestep) * REWARD_BUCKET_SCALE);
-                sig += "R" + std::to_string(reward_bucket);
-                return sig;
-            };
+        sweep_agent_events(replay.agents[agent_index], INT_MIN,
+                           [&](int timestep, const std::vector<float>& item_values, float total_reward) {
+            for (size_t d = 0; d < dim_ids.size(); d++) {
+                int item_id = dim_ids[d];
+                local.quantities[d] = item_id >= 0 && static_cast<size_t>(item_id) < item_values.size() ? item_values[item_id] : 0.0f;
+            }
+            int reward_bucket = spec.reward.bin(total_reward);
+            StateKey key = make_state_key(layout, spec, dim_ids, local.quantities, timestep, reward_bucket);
+            uint64_t order = sweep_order(agent_index, timestep);
             
-            std::string current_state = create_state_sig(current_time);
-            std::string next_state = create_state_sig(next_time);
+            // A worker visits its events in increasing sweep order, so only its
+            // first sighting of a state can lower the shared first-seen order
+            uint32_t next_state;
+            const uint32_t* cached = local.seen_states.find(key);
+            if (cached) {
+                next_state = *cached;
+            } else {
+                next_state = shared_states.intern(key, order);
+                local.seen_states.insert(key, next_state);
+            }
             
             // Only create transition if states are different
-            if (current_state != next_state) {
-                transition_count[{current_state, next_state}]++;
+            if (current_state != UINT32_MAX && current_state != next_state) {
+                StateKey pair_key{(static_cast<uint64_t>(current_state) << 32) | next_state, 0};
+                auto transition = local.transition_index.insert(pair_key, static_cast<uint32_t>(local.tallies.size()));
+                if (transition.second) {
+                    local.tallies.push_back(TransitionTally{current_state, next_state, 0, order});
+                }
+                local.tallies[transition.first].count++;
             }
+            current_state = next_state;
+        });
+    });
+    
+    // Renumber states by first sighting in serial sweep order, which makes the
+    // output identical for any thread count
+    std::vector<uint32_t> state_order;
+    state_order.reserve(shared_states.size());
+    shared_states.for_each([&](uint32_t id) { state_order.push_back(id); });
+    std::sort(state_order.begin(), state_order.end(), [&](uint32_t a, uint32_t b) {
+        return shared_states.first_seen(a) < shared_states.first_seen(b);
+    });
+    
+    std::vector<uint32_t> final_state(shared_states.id_bound(), UINT32_MAX);
+    std::vector<StateKey> state_keys;
+    std::vector<uint32_t> state_node_ids;
+    std::vector<float> quantities(dim_ids.size(), 0.0f);
+    const InventoryTensor& dense = replay.dense_inventory;
+    for (uint32_t id : state_order) {
+        final_state[id] = static_cast<uint32_t>(state_keys.size());
+        state_keys.push_back(shared_states.key(id));
+        
+        // Node styling uses the agent's exact values at the state's first
+        // sighting, read from the dense tensor when it has been materialised
+        uint64_t first_seen = shared_states.first_seen(id);
+        size_t agent_index = static_cast<size_t>(first_seen >> 32);
+        const AgentInventoryState& agent = replay.agents[agent_index];
+        int timestep = sweep_order_timestep(first_seen);
+        bool from_tensor = dense.valid() && agent_index < static_cast<size_t>(dense.agent_count) &&
+                           timestep >= 0 && timestep < dense.timestep_count;
+        for (size_t d = 0; d < dim_ids.size(); d++) {
+            quantities[d] = from_tensor ? dense.at(static_cast<int>(agent_index), timestep, dim_ids[d])
+                                        : agent.get_inventory_at_time(dim_ids[d], timestep);
         }
+        float total_reward = agent.get_total_reward_at_time(timestep);
+        int reward_bucket = spec.reward.bin(total_reward);
+        state_node_ids.push_back(add_state_node(graph3d, spec, quantities, total_reward,
+                                                reward_bucket, timestep));
     }
     
-    // Create edges from observed transitions
-    for (const auto& [transition, count] : transition_count) {
-        const std::string& from_state = transition.first;
-        const std::string& to_state = transition.second;
-        
-        auto from_iter = state_to_node_id.find(from_state);
-        auto to_iter = state_to_node_id.find(to_state);
-        
-        if (from_iter != state_to_node_id.end() && to_iter != state_to_node_id.end()) {
-            uint32_t from_id = from_iter->second;
-            uint32_t to_id = to_iter->second;
-            
-            // Extract reward levels for edge styling
-            int from_reward = 0, to_reward = 0;
-            size_t r_pos = from_state.find('R');
-            if (r_pos != std::string::npos) from_reward = std::stoi(from_state.substr(r_pos + 1));
-            r_pos = to_state.find('R');
-            if (r_pos != std::string::npos) to_reward = std::stoi(to_state.substr(r_pos + 1));
-            
-            // Color edges based on reward change
-            Color edge_color;
-            if (to_reward > from_reward) {
-                edge_color = Color(100, 255, 100, 255); // Green for reward increase
-            } else if (to_reward < from_reward) {
-                edge_color = Color(255, 100, 100, 255); // Red for reward decrease
+    // Merge the per-worker transition tallies under final state numbers
+    StateKeyTable transition_index;
+    std::vector<TransitionTally> transitions;
+    for (const WorkerState& local : worker_states) {
+        for (const TransitionTally& tally : local.tallies) {
+            uint32_t from_state = final_state[tally.from_state];
+            uint32_t to_state = final_state[tally.to_state];
+            StateKey pair_key{(static_cast<uint64_t>(from_state) << 32) | to_state, 0};
+            auto inserted = transition_index.insert(pair_key, static_cast<uint32_t>(transitions.size()));
+            if (inserted.second) {
+                transitions.push_back(TransitionTally{from_state, to_state, tally.count, tally.first_seen});
             } else {
-                edge_color = GRAY; // Gray for no reward change
+                TransitionTally& merged = transitions[inserted.first];
+                merged.count += tally.count;
+                merged.first_seen = std::min(merged.first_seen, tally.first_seen);
             }
-            
-            // Thickness based on transition frequency
-            float thickness = 1.0f + static_cast<float>(count) * 0.5f;
-            
-            graph3d.add_edge(from_id, to_id, edge_color, thickness);
         }
     }
+    std::sort(transitions.begin(), transitions.end(), [](const TransitionTally& a, const TransitionTally& b) {
+        return a.first_seen < b.first_seen;
+    });
     
-    std::cout << "Created " << transition_count.size() << " temporal transitions between states\n";
+    // Create edges from observed transitions
+    for (const TransitionTally& transition : transitions) {
+        // Reward levels for edge styling come straight out of the keys
+        int from_reward = layout.get(state_keys[transition.from_state], reward_field);
+        int to_reward = layout.get(state_keys[transition.to_state], reward_field);
+        
+        // Thickness based on transition frequency
+        float thickness = 1.0f + static_cast<float>(transition.count) * 0.5f;
+        
+        graph3d.add_edge(state_node_ids[transition.from_state], state_node_ids[transition.to_state],
+                         transition_color(from_reward, to_reward), thickness);
+    }
     
-    std::cout << "Created " << state_to_node_id.size() << " unique inventory states\n";
+    std::cout << "Created " << transitions.size() << " temporal transitions between states\n";
+    
+    std::cout << "Created " << state_keys.size() << " unique inventory states\n";
     
     // DEBUG: Check if objects format is creating any inventory data
     if (replay.inventory_items.size() > 0 && replay.agents.size() > 0) {
         const auto& sample_agent = replay.agents[0];
-        std::cout << "DEBUG: Sample agent inventory data size: " << sample_agent.inventory_over_time.size() << std::endl;
-        for (const auto& [item, values] : sample_agent.inventory_over_time) {
-            std::cout << "  " << item << ": " << values.size() << " timesteps" << std::endl;
-            if (!values.empty()) {
-                std::cout << "    First value: " << values[0].value << " at timestep " << values[0].timestep << std::endl;
+        std::cout << "DEBUG: Sample agent inventory data size: " << sample_agent.item_count() << std::endl;
+        for (size_t item_id = 0; item_id < sample_agent.item_count(); item_id++) {
+            InventorySeries series = sample_agent.inventory_series(static_cast<int>(item_id));
+            std::cout << "  " << replay.item_name(static_cast<int>(item_id)) << ": " << series.size << " timesteps" << std::endl;
+            if (!series.empty()) {
+                std::cout << "    First value: " << series.values[0] << " at timestep " << series.timesteps[0] << std::endl;
             }
         }
     }
@@ -573,16 +1491,89 @@ void AgentGraphBuilder::build_inventory_dimensional_graph(const ReplayData& repl
     // Don't apply force layout here - let it happen in real-time for visualization
 }
 
-void AgentGraphBuilder::build_temporal_graph(const ReplayData& replay, Graph3D& graph3d, int target_agent_id) {
+void AgentGraphBuilder::trajectory_significance(const std::vector<std::pair<int, Vector3>>& trajectory,
+                                                std::vector<float>& significance) {
+    // Douglas-Peucker over the grid path: each interior point scores its
+    // distance from the chord it splits, capped by its parent split's score so
+    // any threshold yields a valid simplification. Endpoints always stay;
+    // points on a straight run (or where the agent stood still) score 0.
+    size_t n = trajectory.size();
+    significance.assign(n, 0.0f);
+    if (n == 0) return;
+    significance.front() = significance.back() = std::numeric_limits<float>::infinity();
+    
+    struct Span { size_t first, last; float cap; };
+    std::vector<Span> stack;
+    if (n > 2) stack.push_back(Span{0, n - 1, std::numeric_limits<float>::infinity()});
+    while (!stack.empty()) {
+        Span span = stack.back();
+        stack.pop_back();
+        
+        Vector3 a = trajectory[span.first].second;
+        Vector3 ab = trajectory[span.last].second - a;
+        float ab_len_sq = ab.x * ab.x + ab.y * ab.y + ab.z * ab.z;
+        float best = 0.0f;
+        size_t best_index = span.first;
+        for (size_t i = span.first + 1; i < span.last; i++) {
+            Vector3 ap = trajectory[i].second - a;
+            float t = ab_len_sq > 0.0f ? std::max(0.0f, std::min(1.0f, (ap.x * ab.x + ap.y * ab.y + ap.z * ab.z) / ab_len_sq)) : 0.0f;
+            float d = (ap - ab * t).length();
+            if (d > best) {
+                best = d;
+                best_index = i;
+            }
+        }
+        if (best <= 0.0f) continue;
+        
+        float score = std::min(best, span.cap);
+        significance[best_index] = score;
+        if (best_index - span.first > 1) stack.push_back(Span{span.first, best_index, score});
+        if (span.last - best_index > 1) stack.push_back(Span{best_index, span.last, score});
+    }
+}
+
+void AgentGraphBuilder::build_temporal_graph(const ReplayData& replay, Graph3D& graph3d, int target_agent_id,
+                                             uint32_t node_budget) {
     std::cout << "Building temporal graph for agent trajectories\n";
     
+    // Score every trajectory point of the selected agents
+    std::vector<const AgentInventoryState*> agents;
+    std::vector<std::vector<float>> significance;
     for (const auto& agent : replay.agents) {
         if (target_agent_id >= 0 && agent.agent_id != target_agent_id) continue;
+        agents.push_back(&agent);
+        significance.emplace_back();
+        trajectory_significance(agent.location_over_time, significance.back());
+    }
+    
+    // One threshold across agents: busier trajectories get more of the budget
+    uint32_t budget = std::min(node_budget, MAX_NODES - graph3d.node_count);
+    std::vector<float> scores;
+    size_t total_points = 0;
+    for (const auto& agent_scores : significance) {
+        total_points += agent_scores.size();
+        for (float score : agent_scores) {
+            if (score > 0.0f) scores.push_back(score);
+        }
+    }
+    float threshold = 0.0f;
+    if (scores.size() > budget) {
+        // Keep the budget's worth of highest scores (endpoints are infinite, so they go first)
+        std::nth_element(scores.begin(), scores.begin() + budget, scores.end(), std::greater<float>());
+        threshold = scores[budget];
+        // Fewer nodes than endpoints: keep endpoints in agent order until the budget runs out
+        if (std::isinf(threshold)) threshold = std::numeric_limits<float>::max();
+    }
+    
+    uint32_t kept = 0;
+    for (size_t a = 0; a < agents.size() && kept < budget; a++) {
+        const AgentInventoryState& agent = *agents[a];
+        uint32_t previous_node = UINT32_MAX;
+        float previous_reward = 0.0f;
         
-        // Sample locations at intervals
-        int interval = std::max(1, static_cast<int>(agent.location_over_time.size()) / 20);
-        
-        for (size_t i = 0; i < agent.location_over_time.size(); i += interval) {
+        for (size_t i = 0; i < agent.location_over_time.size() && kept < budget; i++) {
+            if (significance[a][i] <= threshold) continue;
+            
             const auto& loc_entry = agent.location_over_time[i];
             int timestep = loc_entry.first;
             Vector3 grid_pos = loc_entry.second;
@@ -595,12 +1586,155 @@ void AgentGraphBuilder::build_temporal_graph(const ReplayData& replay, Graph3D&
             
             std::string label = "A" + std::to_string(agent.agent_id) + "_T" + std::to_string(timestep);
             
-            graph3d.add_node(position, color, 0.4f, label);
+            uint32_t node_id = graph3d.add_node(position, color, 0.4f, label);
+            if (node_id == UINT32_MAX) break;
+            kept++;
+            graph3d.nodes[node_id].agent_id = agent.agent_id;
+            graph3d.nodes[node_id].timestep = timestep;
+            
+            // Connect consecutive samples of this agent
+            if (previous_node != UINT32_MAX) {
+                graph3d.add_edge(previous_node, node_id,
+                                 transition_color(static_cast<int>(previous_reward), static_cast<int>(total_reward)), 1.0f);
+            }
+            previous_node = node_id;
+            previous_reward = total_reward;
         }
     }
     
-    // Connect consecutive timesteps for each agent
-    // (Implementation would track node indices per agent)
+    std::cout << "Kept " << kept << " of " << total_points << " trajectory points across "
+              << agents.size() << " agents (budget " << budget << ")\n";
+}
+
+// calculate_agent_similarity's inverse-distance metric over two inventory rows
+static float feature_similarity(const float* a, const float* b, size_t item_count) {
+    if (item_count == 0) return 0.0f;
+    float similarity = 0.0f;
+    for (size_t i = 0; i < item_count; i++) similarity += 1.0f / (1.0f + std::abs(a[i] - b[i]));
+    return similarity / item_count;
+}
+
+void AgentGraphBuilder::build_agent_similarity_graph(const ReplayData& replay, Graph3D& graph3d, int timestep, int k) {
+    if (timestep < 0) timestep = replay.max_timestep;
+    size_t agent_count = std::min(replay.agents.size(), static_cast<size_t>(MAX_NODES - graph3d.node_count));
+    size_t item_count = replay.items->size();
+    std::cout << "Building agent similarity graph at t=" << timestep << " (" << agent_count << " agents, k=" << k << ")\n";
+    if (agent_count == 0 || k <= 0) return;
+    
+    // Inventory vector of every agent, from the dense tensor when it is materialised
+    std::vector<float> features(agent_count * item_count);
+    const InventoryTensor& tensor = replay.dense_inventory;
+    bool from_tensor = tensor.valid() && static_cast<size_t>(tensor.agent_count) >= agent_count &&
+                       static_cast<size_t>(tensor.item_count) == item_count;
+    for (size_t a = 0; a < agent_count; a++) {
+        for (size_t i = 0; i < item_count; i++) {
+            features[a * item_count + i] = from_tensor
+                ? tensor.at(static_cast<int>(a), timestep, static_cast<int>(i))
+                : replay.agents[a].get_inventory_at_time(static_cast<int>(i), timestep);
+        }
+    }
+    
+    // Random projections: agents close in inventory space land close together
+    // along every direction, so neighbours in those orders are the candidates
+    constexpr int PROJECTIONS = 16;
+    constexpr int WINDOW = 8;  // candidates taken on each side per projection
+    std::mt19937 rng(0x5eed);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> directions(PROJECTIONS * item_count);
+    for (float& d : directions) d = normal(rng);
+    
+    std::vector<float> projected(PROJECTIONS * agent_count, 0.0f);
+    std::vector<std::vector<uint32_t>> orders(PROJECTIONS, std::vector<uint32_t>(agent_count));
+    std::vector<std::vector<uint32_t>> ranks(PROJECTIONS, std::vector<uint32_t>(agent_count));
+    for (int p = 0; p < PROJECTIONS; p++) {
+        float* values = projected.data() + p * agent_count;
+        for (size_t a = 0; a < agent_count; a++) {
+            for (size_t i = 0; i < item_count; i++) values[a] += directions[p * item_count + i] * features[a * item_count + i];
+            orders[p][a] = static_cast<uint32_t>(a);
+        }
+        std::sort(orders[p].begin(), orders[p].end(), [&](uint32_t x, uint32_t y) { return values[x] < values[y]; });
+        for (size_t r = 0; r < agent_count; r++) ranks[p][orders[p][r]] = static_cast<uint32_t>(r);
+    }
+    
+    // Score candidates (every agent when that is no more work) and keep the top k
+    typedef std::vector<std::pair<float, uint32_t>> NeighbourList;
+    auto keep_best = [&](size_t a, std::vector<uint32_t>& candidates, NeighbourList& best) {
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        best.clear();
+        for (uint32_t b : candidates) {
+            if (b == a) continue;
+            best.emplace_back(feature_similarity(&features[a * item_count], &features[b * item_count], item_count), b);
+        }
+        size_t keep = std::min(best.size(), static_cast<size_t>(k));
+        std::partial_sort(best.begin(), best.begin() + keep, best.end(),
+                          [](const std::pair<float, uint32_t>& x, const std::pair<float, uint32_t>& y) {
+                              return x.first != y.first ? x.first > y.first : x.second < y.second;
+                          });
+        best.resize(keep);
+    };
+    
+    bool exact = agent_count <= static_cast<size_t>(2 * WINDOW * PROJECTIONS);
+    std::vector<NeighbourList> neighbours(agent_count);
+    unsigned worker_count = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned>(agent_count)));
+    for_each_agent_parallel(agent_count, worker_count, [&](unsigned, size_t a) {
+        std::vector<uint32_t> candidates;
+        if (exact) {
+            for (size_t b = 0; b < agent_count; b++) candidates.push_back(static_cast<uint32_t>(b));
+        } else {
+            for (int p = 0; p < PROJECTIONS; p++) {
+                size_t rank = ranks[p][a];
+                size_t first = rank > WINDOW ? rank - WINDOW : 0;
+                size_t last = std::min(agent_count - 1, rank + WINDOW);
+                for (size_t r = first; r <= last; r++) candidates.push_back(orders[p][r]);
+            }
+        }
+        keep_best(a, candidates, neighbours[a]);
+    });
+    
+    if (!exact) {
+        // One refinement round: a neighbour's neighbours are likely neighbours too,
+        // which recovers most of what the projection windows missed
+        std::vector<NeighbourList> refined(agent_count);
+        for_each_agent_parallel(agent_count, worker_count, [&](unsigned, size_t a) {
+            std::vector<uint32_t> candidates;
+            for (const auto& near : neighbours[a]) {
+                candidates.push_back(near.second);
+                for (const auto& next : neighbours[near.second]) candidates.push_back(next.second);
+            }
+            keep_best(a, candidates, refined[a]);
+        });
+        neighbours.swap(refined);
+    }
+    
+    // Agent nodes, placed by their first three projections
+    uint32_t first_node = graph3d.node_count;
+    for (size_t a = 0; a < agent_count; a++) {
+        const AgentInventoryState& agent = replay.agents[a];
+        Vector3 position(projected[a], projected[agent_count + a], projected[2 * agent_count + a]);
+        Color color = reward_to_color(agent.get_total_reward_at_time(timestep), MAX_REWARD_FOR_COLOR);
+        uint32_t node_id = graph3d.add_node(position, color, 0.5f, "Agent_" + std::to_string(agent.agent_id));
+        graph3d.nodes[node_id].agent_id = agent.agent_id;
+        graph3d.nodes[node_id].timestep = timestep;
+    }
+    
+    // Nearest neighbours first, so the edge limit drops the weakest links
+    StateKeyTable linked;
+    uint32_t first_edge = graph3d.edge_count;
+    for (int r = 0; r < k && graph3d.edge_count < MAX_EDGES; r++) {
+        for (size_t a = 0; a < agent_count && graph3d.edge_count < MAX_EDGES; a++) {
+            if (static_cast<size_t>(r) >= neighbours[a].size()) continue;
+            float similarity = neighbours[a][r].first;
+            uint32_t b = neighbours[a][r].second;
+            StateKey pair_key{(static_cast<uint64_t>(std::min<uint32_t>(a, b)) << 32) | std::max<uint32_t>(a, b), 0};
+            if (!linked.insert(pair_key, 0).second) continue;
+            graph3d.add_edge(first_node + static_cast<uint32_t>(a), first_node + b, Color(100, 150, 255, 255),
+                             1.0f + 2.0f * similarity);
+        }
+    }
+    
+    std::cout << "Linked " << graph3d.edge_count - first_edge << " agent pairs (" << (exact ? "exact" : "approximate")
+              << " kNN" << (from_tensor ? ", dense tensor" : "") << ")\n";
 }
 
 Vector3 AgentGraphBuilder::inventory_to_position(const AgentInventoryState& agent, 
@@ -662,10 +1796,10 @@ float AgentGraphBuilder::calculate_agent_similarity(const AgentInventoryState& a
     float similarity = 0.0f;
     int item_count = 0;
     
-    // Compare inventory states
-    for (const auto& [item, values] : agent1.inventory_over_time) {
-        float val1 = agent1.get_inventory_at_time(item, timestep);
-        float val2 = agent2.get_inventory_at_time(item, timestep);
+    // Compare inventory states (both agents share the replay's item table)
+    for (size_t item_id = 0; item_id < agent1.item_count(); item_id++) {
+        float val1 = agent1.get_inventory_at_time(static_cast<int>(item_id), timestep);
+        float val2 = agent2.get_inventory_at_time(static_cast<int>(item_id), timestep);
         
         float diff = std::abs(val1 - val2);
         similarity += 1.0f / (1.0f + diff); // Inverse distance similarity
@@ -673,4 +1807,432 @@ float AgentGraphBuilder::calculate_agent_similarity(const AgentInventoryState& a
     }
     
     return item_count > 0 ? similarity / item_count : 0.0f;
-}
\ No newline at end of file
+}
+
+// InventoryGraphSession methods
+InventoryGraphSession::InventoryGraphSession(Graph3D& graph3d, const StateSpec& state_spec)
+    : graph(graph3d), spec(state_spec), layout(StateKeyLayout::uniform(state_spec.dims.size() + 1)) {
+    if (!valid()) {
+        std::cerr << "State dimensions do not fit in a " << StateKeyLayout::MAX_BITS << "-bit key\n";
+    }
+}
+
+void InventoryGraphSession::update_agent(const ReplayData& replay, size_t agent_index) {
+    if (!valid()) return;
+    const AgentInventoryState& agent = replay.agents[agent_index];
+    AgentProgress& state = progress[agent.agent_id];
+    
+    // Items can be declared after the session starts, so resolve names per update
+    std::vector<int> dim_ids = AgentGraphBuilder::resolve_state_dims(replay, spec);
+    
+    // Sweep the events from this agent's last contributed timestep on; that one
+    // is included in case the new lines added events to it
+    int after_timestep = state.last_timestep == INT_MIN ? INT_MIN : state.last_timestep - 1;
+    std::vector<float> quantities(spec.dims.size(), 0.0f);
+    bool clamped = false;
+    sweep_agent_events(agent, after_timestep, [&](int timestep, const std::vector<float>& item_values, float total_reward) {
+        for (size_t d = 0; d < spec.dims.size(); d++) {
+            int item_id = dim_ids[d];
+            quantities[d] = item_id >= 0 && static_cast<size_t>(item_id) < item_values.size() ? item_values[item_id] : 0.0f;
+        }
+        int reward_bucket = spec.reward.bin(total_reward);
+        StateKey key = AgentGraphBuilder::make_state_key(layout, spec, dim_ids, quantities, timestep, reward_bucket, &clamped);
+        
+        auto inserted = state_index.insert(key, static_cast<uint32_t>(state_keys.size()));
+        uint32_t state_id = inserted.first;
+        if (inserted.second) {
+            state_keys.push_back(key);
+            state_node_ids.push_back(AgentGraphBuilder::add_state_node(graph, spec, quantities, total_reward,
+                                                                       reward_bucket, timestep));
+        }
+        
+        if (timestep == state.last_timestep) {
+            if (state_id == state.last_state) return;
+            // The earlier sweep saw only part of this timestep: take back the
+            // transition it counted and count the complete one instead. A state
+            // only the partial view reached keeps its node.
+            if (state.last_transition != UINT32_MAX) uncount_transition(state.last_transition);
+            state.last_state = state.previous_state;
+        }
+        
+        state.previous_state = state.last_state;
+        state.last_transition = count_transition(state.last_state, state_id);
+        state.last_state = state_id;
+        state.last_timestep = timestep;
+    });
+    
+    if (clamped && !reported_clamping) {
+        std::cerr << "State bins exceed the range of their key fields; some distinct states share a node\n";
+        reported_clamping = true;
+    }
+}
+
+uint32_t InventoryGraphSession::count_transition(uint32_t from_state, uint32_t to_state) {
+    if (from_state == UINT32_MAX || from_state == to_state) return UINT32_MAX;
+    
+    // The first sighting creates the edge, later ones thicken it
+    StateKey pair_key{(static_cast<uint64_t>(from_state) << 32) | to_state, 0};
+    const uint32_t* found = transition_index.find(pair_key);
+    uint32_t transition_id = found ? *found : static_cast<uint32_t>(transitions.size());
+    if (!found) {
+        transition_index.insert(pair_key, transition_id);
+        transitions.push_back(TransitionEdge{UINT32_MAX, 0});
+    }
+    
+    TransitionEdge& transition = transitions[transition_id];
+    if (transition.edge_index == UINT32_MAX) {
+        if (graph.edge_count >= MAX_EDGES || state_node_ids[from_state] >= graph.node_count ||
+            state_node_ids[to_state] >= graph.node_count) {
+            return UINT32_MAX;
+        }
+        size_t reward_field = spec.dims.size();
+        int from_reward = layout.get(state_keys[from_state], reward_field);
+        int to_reward = layout.get(state_keys[to_state], reward_field);
+        transition.edge_index = graph.edge_count;
+        graph.add_edge(state_node_ids[from_state], state_node_ids[to_state],
+                       AgentGraphBuilder::transition_color(from_reward, to_reward), 1.5f);
+        edge_transitions.resize(graph.edge_count, UINT32_MAX);
+        edge_transitions[transition.edge_index] = transition_id;
+        transition.count = 1;
+    } else {
+        transition.count++;
+        graph.edges[transition.edge_index].thickness = 1.0f + static_cast<float>(transition.count) * 0.5f;
+    }
+    return transition_id;
+}
+
+void InventoryGraphSession::uncount_transition(uint32_t transition_id) {
+    TransitionEdge& transition = transitions[transition_id];
+    if (transition.edge_index == UINT32_MAX) return;
+    if (--transition.count > 0) {
+        graph.edges[transition.edge_index].thickness = 1.0f + static_cast<float>(transition.count) * 0.5f;
+        return;
+    }
+    
+    // Fill the hole with the last edge so the edge array stays dense
+    uint32_t last = graph.edge_count - 1;
+    if (transition.edge_index != last) {
+        graph.edges[transition.edge_index] = graph.edges[last];
+        uint32_t moved = edge_transitions[last];
+        edge_transitions[transition.edge_index] = moved;
+        if (moved != UINT32_MAX) transitions[moved].edge_index = transition.edge_index;
+    }
+    graph.edge_count--;
+    edge_transitions.resize(graph.edge_count);
+    transition.edge_index = UINT32_MAX;
+}
+
+// AggregateGraphBuilder methods
+AggregateGraphBuilder::AggregateGraphBuilder(const StateSpec& state_spec)
+    : spec(state_spec), layout(StateKeyLayout::uniform(state_spec.dims.size() + 1)) {
+    if (!valid()) {
+        std::cerr << "State dimensions do not fit in a " << StateKeyLayout::MAX_BITS << "-bit key\n";
+    }
+}
+
+void AggregateGraphBuilder::add_replay(const ReplayData& replay) {
+    if (!valid()) return;
+    
+    // Item ids are per replay, so names are resolved again for every episode
+    std::vector<int> dim_ids = AgentGraphBuilder::resolve_state_dims(replay, spec);
+    std::vector<float> quantities(spec.dims.size(), 0.0f);
+    bool clamped = false;
+    
+    for (const auto& agent : replay.agents) {
+        uint32_t current_state = UINT32_MAX;
+        sweep_agent_events(agent, INT_MIN, [&](int timestep, const std::vector<float>& item_values, float total_reward) {
+            for (size_t d = 0; d < spec.dims.size(); d++) {
+                int item_id = dim_ids[d];
+                quantities[d] = item_id >= 0 && static_cast<size_t>(item_id) < item_values.size() ? item_values[item_id] : 0.0f;
+            }
+            int reward_bucket = spec.reward.bin(total_reward);
+            StateKey key = AgentGraphBuilder::make_state_key(layout, spec, dim_ids, quantities, timestep, reward_bucket,
+                                                             &clamped);
+            
+            auto inserted = state_index.insert(key, static_cast<uint32_t>(state_keys.size()));
+            uint32_t state_id = inserted.first;
+            if (inserted.second) {
+                state_keys.push_back(key);
+                state_quantities.insert(state_quantities.end(), quantities.begin(), quantities.end());
+                state_samples.push_back(StateSample{total_reward, timestep});
+                visits.push_back(0);
+            }
+            if (state_id == current_state) return;
+            
+            visits[state_id]++;
+            if (current_state != UINT32_MAX) {
+                StateKey pair_key{(static_cast<uint64_t>(current_state) << 32) | state_id, 0};
+                auto transition = transition_index.insert(pair_key, static_cast<uint32_t>(transitions.size()));
+                if (transition.second) {
+                    transitions.push_back(TransitionCount{current_state, state_id, 0});
+                }
+                transitions[transition.first].count++;
+            }
+            current_state = state_id;
+        });
+    }
+    
+    if (clamped && !reported_clamping) {
+        std::cerr << "State bins exceed the range of their key fields; some distinct states share a node\n";
+        reported_clamping = true;
+    }
+    
+    replays++;
+    std::cout << "Aggregated replay " << replays << " (" << replay.agents.size() << " agents): "
+              << state_keys.size() << " states, " << transitions.size() << " transitions so far" << std::endl;
+}
+
+void AggregateGraphBuilder::build(Graph3D& graph3d) const {
+    // Keep the most visited states when there are more than the graph can hold;
+    // the stable sort leaves ties in first-seen order
+    std::vector<uint32_t> order(state_keys.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    if (order.size() > MAX_NODES) {
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return visits[a] > visits[b]; });
+        std::cout << "Keeping the " << MAX_NODES << " most visited of " << order.size() << " aggregate states\n";
+        order.resize(MAX_NODES);
+        std::sort(order.begin(), order.end());
+    }
+    
+    size_t reward_field = spec.dims.size();
+    std::vector<uint32_t> state_node_ids(state_keys.size(), UINT32_MAX);
+    std::vector<float> quantities(spec.dims.size());
+    for (uint32_t state_id : order) {
+        const StateSample& sample = state_samples[state_id];
+        quantities.assign(state_quantities.begin() + state_id * spec.dims.size(),
+                          state_quantities.begin() + (state_id + 1) * spec.dims.size());
+        int reward_bucket = layout.get(state_keys[state_id], reward_field);
+        uint32_t node_id = AgentGraphBuilder::add_state_node(graph3d, spec, quantities, sample.total_reward,
+                                                             reward_bucket, sample.timestep);
+        if (node_id == UINT32_MAX) break;
+        
+        // Frequently visited states grow logarithmically with their visit count
+        GraphNode& node = graph3d.nodes[node_id];
+        node.radius *= 1.0f + 0.25f * std::log2(static_cast<float>(visits[state_id]));
+        node.value = static_cast<float>(visits[state_id]);
+        state_node_ids[state_id] = node_id;
+    }
+    
+    // Counts over many episodes get large, so thickness is logarithmic too
+    for (const TransitionCount& transition : transitions) {
+        uint32_t from_node = state_node_ids[transition.from_state];
+        uint32_t to_node = state_node_ids[transition.to_state];
+        if (from_node == UINT32_MAX || to_node == UINT32_MAX) continue;
+        
+        int from_reward = layout.get(state_keys[transition.from_state], reward_field);
+        int to_reward = layout.get(state_keys[transition.to_state], reward_field);
+        float thickness = 1.0f + std::log2(static_cast<float>(transition.count) + 1.0f);
+        graph3d.add_edge(from_node, to_node, AgentGraphBuilder::transition_color(from_reward, to_reward), thickness);
+    }
+    
+    std::cout << "Aggregate graph over " << replays << " replays: " << graph3d.node_count << " nodes, "
+              << graph3d.edge_count << " edges\n";
+}
+
+// Bottom-up min segment tree over values, padded to a power of two
+static void build_min_tree(const std::vector<int64_t>& values, std::vector<int64_t>& tree) {
+    size_t leaves = 1;
+    while (leaves < values.size()) leaves <<= 1;
+    tree.assign(2 * leaves, INT64_MAX);
+    std::copy(values.begin(), values.end(), tree.begin() + leaves);
+    for (size_t node = leaves - 1; node > 0; node--) tree[node] = std::min(tree[2 * node], tree[2 * node + 1]);
+}
+
+// Call fn(i) for every i in [lo, hi) with values[i] < limit, in index order.
+// Only subtrees holding a match are entered: O((matches + 1) log n).
+template <typename Fn>
+static void report_below(const std::vector<int64_t>& tree, size_t node, size_t node_lo, size_t node_hi,
+                         size_t lo, size_t hi, int64_t limit, Fn&& fn) {
+    if (node_hi <= lo || hi <= node_lo || tree[node] >= limit) return;
+    if (node_hi - node_lo == 1) {
+        fn(node_lo);
+        return;
+    }
+    size_t mid = node_lo + (node_hi - node_lo) / 2;
+    report_below(tree, 2 * node, node_lo, mid, lo, hi, limit, fn);
+    report_below(tree, 2 * node + 1, mid, node_hi, lo, hi, limit, fn);
+}
+
+template <typename Fn>
+static void report_below(const std::vector<int64_t>& tree, size_t lo, size_t hi, int64_t limit, Fn&& fn) {
+    if (lo < hi) report_below(tree, 1, 0, tree.size() / 2, lo, hi, limit, fn);
+}
+
+// WindowedStateGraph methods
+WindowedStateGraph::WindowedStateGraph(const ReplayData& replay, const StateSpec& state_spec) : spec(state_spec) {
+    std::vector<int> dim_ids = AgentGraphBuilder::resolve_state_dims(replay, spec);
+    layout = AgentGraphBuilder::fit_state_key_layout(replay, spec, dim_ids, std::thread::hardware_concurrency());
+    size_t reward_field = dim_ids.size();
+    if (layout.field_count() != reward_field + 1) {
+        std::cerr << "State dimensions do not fit in a " << StateKeyLayout::MAX_BITS << "-bit key\n";
+        return;
+    }
+    
+    // Same serial sweep as the full build, so state and transition ids come
+    // out in its order
+    StateKeyTable state_index;
+    StateKeyTable transition_index;
+    std::vector<float> quantities(dim_ids.size(), 0.0f);
+    for (size_t agent_index = 0; agent_index < replay.agents.size(); agent_index++) {
+        uint32_t current_state = UINT32_MAX;
+        sweep_agent_events(replay.agents[agent_index], INT_MIN,
+                           [&](int timestep, const std::vector<float>& item_values, float total_reward) {
+            for (size_t d = 0; d < dim_ids.size(); d++) {
+                int item_id = dim_ids[d];
+                quantities[d] = item_id >= 0 && static_cast<size_t>(item_id) < item_values.size() ? item_values[item_id] : 0.0f;
+            }
+            int reward_bucket = spec.reward.bin(total_reward);
+            StateKey key = AgentGraphBuilder::make_state_key(layout, spec, dim_ids, quantities, timestep, reward_bucket);
+            
+            auto inserted = state_index.insert(key, static_cast<uint32_t>(state_keys.size()));
+            uint32_t state_id = inserted.first;
+            if (inserted.second) {
+                state_keys.push_back(key);
+                state_quantities.insert(state_quantities.end(), quantities.begin(), quantities.end());
+                state_samples.push_back(StateSample{total_reward, timestep});
+            }
+            if (state_id == current_state) return;
+            
+            uint32_t transition_id = UINT32_MAX;
+            if (current_state != UINT32_MAX) {
+                StateKey pair_key{(static_cast<uint64_t>(current_state) << 32) | state_id, 0};
+                auto transition = transition_index.insert(pair_key, static_cast<uint32_t>(transitions.size()));
+                if (transition.second) transitions.emplace_back(current_state, state_id);
+                transition_id = transition.first;
+            }
+            events.push_back(Event{timestep, static_cast<uint32_t>(agent_index), state_id, transition_id});
+            current_state = state_id;
+        });
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.timestep < b.timestep; });
+    
+    // Link each event to the previous one for its state, its transition and its agent
+    std::vector<int64_t> state_repeat(events.size()), transition_repeat(events.size()), stay_end(events.size());
+    std::vector<int64_t> last_state_event(state_keys.size(), -1);
+    std::vector<int64_t> last_transition_event(transitions.size(), -1);
+    std::vector<int64_t> last_agent_event(replay.agents.size(), -1);
+    transition_offsets.assign(transitions.size() + 1, 0);
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        state_repeat[i] = last_state_event[event.to_state];
+        last_state_event[event.to_state] = static_cast<int64_t>(i);
+        transition_repeat[i] = INT64_MAX;
+        if (event.transition != UINT32_MAX) {
+            transition_repeat[i] = last_transition_event[event.transition];
+            last_transition_event[event.transition] = static_cast<int64_t>(i);
+            transition_offsets[event.transition + 1]++;
+        }
+        // A stay lasts until the agent's next entry (forever for its last state)
+        stay_end[i] = INT64_MIN;
+        if (last_agent_event[event.agent] >= 0) stay_end[last_agent_event[event.agent]] = -static_cast<int64_t>(event.timestep);
+        last_agent_event[event.agent] = static_cast<int64_t>(i);
+    }
+    build_min_tree(state_repeat, state_repeat_tree);
+    build_min_tree(transition_repeat, transition_repeat_tree);
+    build_min_tree(stay_end, stay_end_tree);
+    
+    for (size_t t = 0; t < transitions.size(); t++) transition_offsets[t + 1] += transition_offsets[t];
+    transition_times.resize(transition_offsets.back());
+    std::vector<uint32_t> fill(transition_offsets.begin(), transition_offsets.end() - 1);
+    for (const Event& event : events) {
+        if (event.transition != UINT32_MAX) transition_times[fill[event.transition]++] = event.timestep;
+    }
+    
+    state_positions.resize(state_keys.size());
+    has_position.assign(state_keys.size(), 0);
+    state_stamp.assign(state_keys.size(), 0);
+    transition_counts.assign(transitions.size(), 0);
+    std::cout << "Timeline index: " << events.size() << " state entries over timesteps "
+              << first_timestep() << "-" << last_timestep() << std::endl;
+}
+
+void WindowedStateGraph::adopt_full_graph(const Graph3D& graph3d) {
+    // The full build numbers nodes in state id order
+    window_states.clear();
+    for (uint32_t i = 0; i < graph3d.node_count && i < state_keys.size(); i++) window_states.push_back(i);
+}
+
+void WindowedStateGraph::extract(int t0, int t1, Graph3D& graph3d) {
+    // Remember where the current window's states were laid out
+    for (uint32_t node = 0; node < window_states.size() && node < graph3d.node_count; node++) {
+        state_positions[window_states[node]] = graph3d.nodes[node].position;
+        has_position[window_states[node]] = 1;
+    }
+    
+    // Stamps mark what this window has seen without clearing per-id arrays
+    if (++stamp == 0) {
+        std::fill(state_stamp.begin(), state_stamp.end(), 0);
+        stamp = 1;
+    }
+    std::vector<uint32_t> window_transitions;
+    window_states.clear();
+    auto visit_state = [&](uint32_t state_id) {
+        if (state_stamp[state_id] != stamp) {
+            state_stamp[state_id] = stamp;
+            window_states.push_back(state_id);
+        }
+    };
+    
+    auto begin = std::lower_bound(events.begin(), events.end(), t0,
+                                  [](const Event& e, int t) { return e.timestep < t; });
+    auto end = std::lower_bound(begin, events.end(), t1, [](const Event& e, int t) { return e.timestep < t; });
+    size_t first = static_cast<size_t>(begin - events.begin());
+    size_t last = static_cast<size_t>(end - events.begin());
+    if (t0 < t1) {
+        // States agents already occupy when the window opens: stays entered
+        // before t0 that end after it
+        report_below(stay_end_tree, 0, first, -static_cast<int64_t>(t0),
+                     [&](size_t i) { visit_state(events[i].to_state); });
+        
+        // Each state and transition once, at its first event inside the window
+        int64_t window_first = static_cast<int64_t>(first);
+        report_below(state_repeat_tree, first, last, window_first,
+                     [&](size_t i) { visit_state(events[i].to_state); });
+        report_below(transition_repeat_tree, first, last, window_first, [&](size_t i) {
+            uint32_t transition_id = events[i].transition;
+            const int* times = transition_times.data() + transition_offsets[transition_id];
+            const int* times_end = transition_times.data() + transition_offsets[transition_id + 1];
+            transition_counts[transition_id] = static_cast<uint32_t>(std::lower_bound(times, times_end, t1) -
+                                                                     std::lower_bound(times, times_end, t0));
+            window_transitions.push_back(transition_id);
+        });
+    }
+    
+    // Full-build order: ascending state and transition ids
+    std::sort(window_states.begin(), window_states.end());
+    std::sort(window_transitions.begin(), window_transitions.end());
+    
+    graph3d.clear();
+    std::vector<float> quantities(spec.dims.size());
+    size_t reward_field = spec.dims.size();
+    std::vector<uint32_t> kept_states;
+    for (uint32_t state_id : window_states) {
+        const StateSample& sample = state_samples[state_id];
+        quantities.assign(state_quantities.begin() + state_id * spec.dims.size(),
+                          state_quantities.begin() + (state_id + 1) * spec.dims.size());
+        uint32_t node_id = AgentGraphBuilder::add_state_node(graph3d, spec, quantities, sample.total_reward,
+                                                             layout.get(state_keys[state_id], reward_field), sample.timestep,
+                                                             false);
+        if (node_id == UINT32_MAX) break;
+        if (has_position[state_id]) graph3d.nodes[node_id].position = state_positions[state_id];
+        kept_states.push_back(state_id);
+    }
+    window_states = kept_states;
+    
+    // Node id of each kept state, via a binary search in the sorted window
+    auto node_of = [&](uint32_t state_id) -> uint32_t {
+        auto it = std::lower_bound(window_states.begin(), window_states.end(), state_id);
+        return it != window_states.end() && *it == state_id ? static_cast<uint32_t>(it - window_states.begin()) : UINT32_MAX;
+    };
+    for (uint32_t transition_id : window_transitions) {
+        uint32_t from_node = node_of(transitions[transition_id].first);
+        uint32_t to_node = node_of(transitions[transition_id].second);
+        if (from_node == UINT32_MAX || to_node == UINT32_MAX) continue;
+        
+        int from_reward = layout.get(state_keys[transitions[transition_id].first], reward_field);
+        int to_reward = layout.get(state_keys[transitions[transition_id].second], reward_field);
+        float thickness = 1.0f + static_cast<float>(transition_counts[transition_id]) * 0.5f;
+        graph3d.add_edge(from_node, to_node, AgentGraphBuilder::transition_color(from_reward, to_reward), thickness);
+    }
+}
+
@@ -1,17 +1,31 @@
 #pragma once
 
 #include "graph.hpp"
+#include "state_key.hpp"
+#include "state_spec.hpp"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <cstdint>
+#include <cstdio>
+#include <climits>
+#include <memory>
+#include <list>
+#include <mutex>
 #include <cjson/cJSON.h>
 
 // Reward visualization constants
-constexpr float REWARD_BUCKET_SCALE = 1.0f;       // Scale factor for reward bucketing
 constexpr float MAX_REWARD_FOR_COLOR = 10.0f;      // Maximum reward for color mapping
 constexpr float TEMPORAL_MAX_REWARD = 10.0f;       // Max reward for temporal visualization
 
+enum class ReplayFormat {
+    Unknown,
+    GridObjects,  // "grid_objects" with "inv:item" arrays
+    Pufferbox,    // "grid_objects" with "agent:inv:item.name" arrays
+    Objects       // "objects" with per-timestep [item_id, qty] lists
+};
+
 struct TimestampValue {
     int timestep;
     float value;
@@ -19,62 +33,416 @@ struct TimestampValue {
     TimestampValue(int t, float v) : timestep(t), value(v) {}
 };
 
+// Interned inventory item names. Items are referred to by dense integer ids
+// everywhere below; names are only needed for I/O and display.
+struct ItemTable {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> ids;
+
+    int intern(const std::string& name);
+    int find(const std::string& name) const; // -1 if unknown
+    size_t size() const { return names.size(); }
+};
+
+// Read-only view of one item's change events inside an agent's columns
+struct InventorySeries {
+    const int* timesteps;
+    const float* values;
+    size_t size;
+
+    bool empty() const { return size == 0; }
+};
+
 struct AgentInventoryState {
     int agent_id;
-    std::unordered_map<std::string, std::vector<TimestampValue>> inventory_over_time;
+
+    // Columnar inventory: events for item id i occupy
+    // [item_offsets[i], item_ends[i]) of inv_timesteps / inv_values, with room
+    // to grow in place up to item_limits[i]. A full load packs the ranges in
+    // item order; append_events may move a range that outgrew its room to the
+    // end, so slots outside every range are unused.
+    std::vector<uint32_t> item_offsets;
+    std::vector<uint32_t> item_ends;
+    std::vector<uint32_t> item_limits;
+    std::vector<int> inv_timesteps;
+    std::vector<float> inv_values;
+    size_t unused_slots = 0; // abandoned by moved ranges; repacked once they outnumber the rest
+    std::shared_ptr<const ItemTable> item_table;
+
     std::vector<TimestampValue> reward_over_time;
     std::vector<TimestampValue> total_reward_over_time;
     std::vector<std::pair<int, Vector3>> location_over_time;
 
-    // Get inventory value at specific timestep
-    float get_inventory_at_time(const std::string& item, int timestep) const;
+    // Flatten per-item event lists (indexed by item id) into the columns
+    void set_inventory_columns(const std::vector<std::vector<TimestampValue>>& per_item);
+    // Append a later slice of the same agent's series (events must not predate
+    // ours). Amortised O(delta): each item grows in place, and one that runs out
+    // of room moves to the end with double the room.
+    void append_events(const AgentInventoryState& delta);
+
+    size_t item_count() const { return item_ends.size(); }
+    InventorySeries inventory_series(int item_id) const;
+
+    // Point lookups binary-search the (time-sorted) series: O(log n)
+    float get_inventory_at_time(int item_id, int timestep) const;
+    float get_inventory_at_time(const std::string& item, int timestep) const; // name lookup shim
     float get_reward_at_time(int timestep) const;
     float get_total_reward_at_time(int timestep) const;
     Vector3 get_location_at_time(int timestep) const;
 };
 
+// Forward-only cursor for monotonic timestep sweeps over one agent. Each
+// advance_to() only moves past events it has not consumed yet, so a full
+// sweep costs O(items + events) instead of a search per lookup.
+struct AgentTimeCursor {
+    const AgentInventoryState* agent;
+    std::vector<uint32_t> item_pos;   // next unconsumed event per item (absolute column index)
+    size_t total_reward_pos;
+    size_t location_pos;
+    int timestep;
+
+    explicit AgentTimeCursor(const AgentInventoryState& agent_state);
+    void advance_to(int target_timestep); // target must not go backwards
+    float inventory(int item_id) const;
+    float total_reward() const;
+    Vector3 location() const;
+};
+
+// Dense [agent][timestep][item] inventory snapshot materialised from the sparse
+// columns. Element width is chosen from the observed value range (uint8, int16,
+// float) and every agent slab starts on a cache-line boundary.
+struct InventoryTensor {
+    enum class ElementType { UInt8, Int16, Float32 };
+
+    ElementType element_type = ElementType::Float32;
+    int agent_count = 0;
+    int timestep_count = 0;
+    int item_count = 0;
+    size_t agent_stride = 0;  // bytes between agent slabs (multiple of 64)
+    size_t data_offset = 0;   // aligned start within storage
+    std::vector<uint8_t> storage;
+
+    bool valid() const { return agent_count > 0 && timestep_count > 0 && item_count > 0; }
+    size_t element_size() const;
+    const uint8_t* agent_data(int agent_index) const { return storage.data() + data_offset + agent_index * agent_stride; }
+    uint8_t* agent_data(int agent_index) { return storage.data() + data_offset + agent_index * agent_stride; }
+    float at(int agent_index, int timestep, int item_id) const;
+};
+
+// Byte range of one agent object inside a lazily opened replay
+struct LazyAgentEntry {
+    int agent_id;
+    size_t begin;
+    size_t end;
+};
+
+// Open replay file plus the agent index built by ReplayParser::open_replay_lazy.
+// Only each agent's byte range is kept; an agent's text is read back with
+// read_file_range when it is decoded, so memory does not grow with the file.
+// Every item name is interned while indexing, so decoding never touches the
+// shared ItemTable. Agents are decoded on first access and kept in a small LRU
+// cache; eviction only drops the cache's reference, so an agent handed out by
+// ReplayData::get_agent stays alive for as long as the caller holds it.
+struct LazyAgentSource {
+    FILE* file = nullptr;  // the replay, or its inflated temporary copy
+    ReplayFormat format = ReplayFormat::Unknown;
+    std::vector<LazyAgentEntry> entries;
+    std::unordered_map<int, size_t> entry_by_id;
+    std::vector<int> item_ids;  // file item index -> interned id
+    size_t capacity = 8;
+
+    using AgentHandle = std::shared_ptr<const AgentInventoryState>;
+    std::list<AgentHandle> decoded;  // most recently used first
+    std::unordered_map<int, std::list<AgentHandle>::iterator> decoded_by_id;
+    std::mutex mutex;
+
+    LazyAgentSource() = default;
+    LazyAgentSource(const LazyAgentSource&) = delete;
+    LazyAgentSource& operator=(const LazyAgentSource&) = delete;
+    ~LazyAgentSource() {
+        if (file) std::fclose(file);
+    }
+};
+
 struct ReplayData {
     std::vector<std::string> inventory_items;
     std::vector<std::string> object_types;
     std::vector<AgentInventoryState> agents;
-    int max_timestep;
+    std::shared_ptr<ItemTable> items = std::make_shared<ItemTable>();
+    int max_timestep = 0;
+    InventoryTensor dense_inventory; // empty until materialize_inventory()
+    std::shared_ptr<LazyAgentSource> lazy_source; // set by ReplayParser::open_replay_lazy
 
     void add_agent(const AgentInventoryState& agent);
-    const AgentInventoryState* get_agent(int agent_id) const;
+    // Looks in `agents` first, then decodes from lazy_source if present. An
+    // agent from `agents` is not owned by the handle and lives as long as the
+    // vector is left alone; a decoded one lives as long as the handle.
+    std::shared_ptr<const AgentInventoryState> get_agent(int agent_id) const;
+    // Build dense_inventory in parallel; returns false (and leaves it empty)
+    // when the tensor would exceed max_bytes
+    bool materialize_inventory(size_t max_bytes = 512u * 1024u * 1024u);
     std::vector<int> get_agent_ids() const;
+    int item_id(const std::string& item) const { return items->find(item); }
+    const std::string& item_name(int item_id) const { return items->names[item_id]; }
 };
 
 class ReplayParser {
+    friend class ReplayFollower;
+
 public:
     static bool parse_replay_file(const std::string& filename, ReplayData& replay_data);
     static bool parse_compressed_replay_file(const std::string& filename, ReplayData& replay_data);
 
+    // Index agent objects by byte range without decoding their series;
+    // ReplayData::get_agent then decodes agents on demand
+    static bool open_replay_lazy(const std::string& filename, bool compressed, ReplayData& replay_data,
+                                 size_t cache_capacity = 8);
+    static bool decode_lazy_agent(const LazyAgentSource& source, const LazyAgentEntry& entry,
+                                  const std::vector<std::string>& inventory_items, AgentInventoryState& agent);
+
 private:
     static bool parse_json_data(const char* json_str, ReplayData& replay_data);
+    static bool index_json_data(std::string_view json, LazyAgentSource& source, ReplayData& replay_data);
+    static const char* format_name(ReplayFormat format);
+    static ReplayFormat parse_replay_header(cJSON* json, ReplayData& replay_data);
+    static std::vector<int> intern_declared_items(ReplayFormat format, ReplayData& replay_data);
+    static bool is_agent_object(cJSON* obj, ReplayFormat format);
+    // Pufferbox item names are interned into `items` as they turn up; pass
+    // nullptr when item_ids already resolves them (lazy decoding)
+    static void parse_agent_object(cJSON* obj, ReplayFormat format, ItemTable* items,
+                                   const std::vector<std::string>& inventory_items,
+                                   const std::vector<int>& item_ids, AgentInventoryState& agent);
     static void parse_timestamp_array(cJSON* array, std::vector<TimestampValue>& output);
-    static void parse_objects_inventory(cJSON* inventory_array, AgentInventoryState& agent,
-                                       const std::vector<std::string>& item_names);
+    static void parse_objects_inventory(cJSON* inventory_array, std::vector<std::vector<TimestampValue>>& per_item,
+                                        const std::vector<int>& item_ids);
     static Vector3 parse_location_array(cJSON* location_array);
 };
 
+// How informative one item is as a state dimension. Moments are
+// time-weighted over [0, max_timestep] across all agents; reward_information
+// is the mutual information (bits) between the item's log2 bin and the
+// total reward's log2 bin.
+struct ItemStatistics {
+    std::string item;
+    double mean = 0.0;
+    double variance = 0.0;
+    uint64_t change_count = 0;
+    double reward_information = 0.0;
+};
+
 class AgentGraphBuilder {
+    friend class InventoryGraphSession;
+    friend class AggregateGraphBuilder;
+    friend class WindowedStateGraph;
+
 public:
-    // Build graph where each node represents agent state at timestep
-    static void build_temporal_graph(const ReplayData& replay, Graph3D& graph3d, int agent_id = -1);
+    // Build graph where each node represents agent state at timestep, with an
+    // edge between consecutive samples of each agent's trajectory. Samples are
+    // chosen by Douglas-Peucker significance across all agents, so at most
+    // node_budget nodes are used and turning points are kept first.
+    static void build_temporal_graph(const ReplayData& replay, Graph3D& graph3d, int agent_id = -1,
+                                     uint32_t node_budget = MAX_NODES);
 
-    // Build graph where position encodes inventory dimensions
+    // Build graph where position encodes inventory dimensions; nodes are the
+    // distinct states under spec's binning (item names alone use default bins).
+    // Agents are swept in parallel (thread_count 0 = all cores); the result
+    // does not depend on the thread count
+    static void build_inventory_dimensional_graph(const ReplayData& replay, Graph3D& graph3d,
+                                                  const StateSpec& spec, unsigned thread_count = 0);
     static void build_inventory_dimensional_graph(const ReplayData& replay, Graph3D& graph3d,
-                                                  const std::vector<std::string>& inventory_dims);
+                                                  const std::vector<std::string>& inventory_dims,
+                                                  unsigned thread_count = 0);
+
+    // One parallel pass over every agent's series; indexed by item id
+    static std::vector<ItemStatistics> compute_item_statistics(const ReplayData& replay, unsigned thread_count = 0);
+    // Up to k items that change and best explain reward, most informative first
+    static std::vector<std::string> select_state_items(const ReplayData& replay, size_t k, unsigned thread_count = 0);
 
     // Build graph where nodes are agents and edges represent similarity
-    static void build_agent_similarity_graph(const ReplayData& replay, Graph3D& graph3d, int timestep = -1);
+    // Each agent links to its k most similar agents at timestep (-1 = the
+    // last one). Neighbours come from an approximate kNN index over the
+    // agents' inventory vectors: agents are ordered along random projections
+    // and only nearby agents in those orders are scored, so the cost grows
+    // as A log A rather than A^2.
+    static void build_agent_similarity_graph(const ReplayData& replay, Graph3D& graph3d, int timestep = -1,
+                                             int k = 5);
 
 private:
     static Vector3 inventory_to_position(const AgentInventoryState& agent,
                                         const std::vector<std::string>& dimensions,
                                         int timestep);
     static Color reward_to_color(float total_reward, float max_reward);
+    static void trajectory_significance(const std::vector<std::pair<int, Vector3>>& trajectory,
+                                        std::vector<float>& significance);
+    // State abstraction: dimension names resolve to item ids (TIME_DIMENSION
+    // for "time") and each state packs into a StateKey
+    static constexpr int TIME_DIMENSION = -2;
+    static std::vector<int> resolve_state_dims(const ReplayData& replay, const StateSpec& spec);
+    static StateKeyLayout fit_state_key_layout(const ReplayData& replay, const StateSpec& spec,
+                                               const std::vector<int>& dim_ids, unsigned worker_count = 1);
+    // Sets *clamped when some bin fell outside its field (distinct states may then share a key)
+    static StateKey make_state_key(const StateKeyLayout& layout, const StateSpec& spec, const std::vector<int>& dim_ids,
+                                   const std::vector<float>& quantities, int timestep, int reward_bucket,
+                                   bool* clamped = nullptr);
+    static uint32_t add_state_node(Graph3D& graph3d, const StateSpec& spec,
+                                   const std::vector<float>& quantities, float total_reward,
+                                   int reward_bucket, int timestep, bool verbose = true);
+    static Color transition_color(int from_reward, int to_reward);
     static float calculate_agent_similarity(const AgentInventoryState& agent1,
                                            const AgentInventoryState& agent2,
                                            int timestep);
-};
\ No newline at end of file
+};
+
+// Incremental form of build_inventory_dimensional_graph for replays that are
+// still growing. Each update_agent() call only visits events newer than the
+// last call for that agent, adding new state nodes and transition edges (and
+// thickening edges that are seen again) without touching the rest of the graph.
+class InventoryGraphSession {
+public:
+    InventoryGraphSession(Graph3D& graph3d, const StateSpec& state_spec);
+
+    // False when the spec has too many dimensions for a state key; updates are then ignored
+    bool valid() const { return layout.field_count() == spec.dims.size() + 1; }
+
+    // A later line may still add events at the agent's last timestep, so that
+    // timestep is swept again and its state replaced if the events changed it
+    void update_agent(const ReplayData& replay, size_t agent_index);
+
+private:
+    struct AgentProgress {
+        int last_timestep = INT_MIN;
+        uint32_t last_state = UINT32_MAX;
+        uint32_t previous_state = UINT32_MAX;   // state before last_timestep
+        uint32_t last_transition = UINT32_MAX;  // transition counted at last_timestep
+    };
+
+    struct TransitionEdge {
+        uint32_t edge_index;  // UINT32_MAX while the count is zero
+        int count;
+    };
+
+    // Returns the counted transition's index, or UINT32_MAX if none was counted
+    uint32_t count_transition(uint32_t from_state, uint32_t to_state);
+    // Take back one count; the edge is removed when none are left
+    void uncount_transition(uint32_t transition_id);
+
+    Graph3D& graph;
+    StateSpec spec;
+    StateKeyLayout layout;               // value ranges are open-ended, so fields are wide and uniform
+    StateKeyTable state_index;           // key -> state id
+    std::vector<StateKey> state_keys;    // by state id
+    std::vector<uint32_t> state_node_ids;
+    StateKeyTable transition_index;      // (from, to) state ids -> transitions index
+    std::vector<TransitionEdge> transitions;
+    std::vector<uint32_t> edge_transitions;          // by graph edge index
+    std::unordered_map<int, AgentProgress> progress; // by agent id
+    bool reported_clamping = false;
+};
+
+// Merges the state graphs of many episodes (e.g. an evaluation sweep) into one.
+// Replays are fed one at a time and can be freed after add_replay(): only the
+// shared state and transition tables are kept, so memory is bounded by the
+// graph rather than the number of episodes. States count their visits (an
+// agent arriving in them; GraphNode::value) and transitions count how often
+// they were taken (edge thickness).
+class AggregateGraphBuilder {
+public:
+    explicit AggregateGraphBuilder(const StateSpec& state_spec);
+
+    // False when the spec has too many dimensions for a state key; replays are then ignored
+    bool valid() const { return layout.field_count() == spec.dims.size() + 1; }
+
+    void add_replay(const ReplayData& replay);
+    // Write the merged graph; past MAX_NODES only the most visited states are kept
+    void build(Graph3D& graph3d) const;
+
+    size_t replay_count() const { return replays; }
+    size_t state_count() const { return state_keys.size(); }
+    size_t transition_count() const { return transitions.size(); }
+
+private:
+    struct StateSample {     // first sighting, used for node placement and color
+        float total_reward;
+        int timestep;
+    };
+
+    struct TransitionCount {
+        uint32_t from_state;
+        uint32_t to_state;
+        uint64_t count;
+    };
+
+    StateSpec spec;
+    StateKeyLayout layout;               // ranges differ between episodes, so fields are wide and uniform
+    StateKeyTable state_index;           // key -> state id
+    std::vector<StateKey> state_keys;    // by state id
+    std::vector<float> state_quantities; // spec.dims.size() values per state id
+    std::vector<StateSample> state_samples;
+    std::vector<uint64_t> visits;        // by state id
+    StateKeyTable transition_index;      // (from, to) state ids -> transitions index
+    std::vector<TransitionCount> transitions;
+    size_t replays = 0;
+    bool reported_clamping = false;
+};
+
+// build_inventory_dimensional_graph restricted to a time window. Every state
+// entry and transition of the replay is recorded once, sorted by timestep.
+// Min segment trees over those events find the first entry of each state and
+// transition inside a window, and the stays still open when it starts, and
+// per-transition sorted times give each count from two binary searches. So
+// extract(t0, t1) costs O((window states + window transitions + agents
+// occupying a state at t0) log events) rather than a pass over all agents or
+// window events. Within a window, states and transitions keep the full
+// build's order, so the window covering the whole episode reproduces the
+// full graph.
+class WindowedStateGraph {
+public:
+    WindowedStateGraph(const ReplayData& replay, const StateSpec& state_spec);
+
+    // Replace graph3d's contents with the graph of [t0, t1): states occupied at
+    // some point in the window and transitions taken inside it. States that
+    // were already on screen keep their positions.
+    void extract(int t0, int t1, Graph3D& graph3d);
+    // Adopt graph3d as the current window when it holds the full build
+    void adopt_full_graph(const Graph3D& graph3d);
+
+    int first_timestep() const { return events.empty() ? 0 : events.front().timestep; }
+    int last_timestep() const { return events.empty() ? 0 : events.back().timestep; }
+    size_t state_count() const { return state_keys.size(); }
+    size_t transition_count() const { return transitions.size(); }
+
+private:
+    struct Event {           // an agent entering to_state
+        int timestep;
+        uint32_t agent;
+        uint32_t to_state;
+        uint32_t transition; // UINT32_MAX for the agent's first state
+    };
+
+    struct StateSample {     // first sighting, used for node placement and color
+        float total_reward;
+        int timestep;
+    };
+
+    StateSpec spec;
+    StateKeyLayout layout;
+    std::vector<StateKey> state_keys;    // by state id, in full-build order
+    std::vector<float> state_quantities; // spec.dims.size() values per state id
+    std::vector<StateSample> state_samples;
+    std::vector<std::pair<uint32_t, uint32_t>> transitions; // (from, to) by transition id, full-build order
+    std::vector<Event> events;           // sorted by timestep
+    // Min trees over events: index of the previous entry into the same state
+    // (-1 if none), of the previous use of the same transition (INT64_MAX for
+    // first states), and minus the timestep the agent leaves the entered state
+    // (INT64_MIN while it never does)
+    std::vector<int64_t> state_repeat_tree, transition_repeat_tree, stay_end_tree;
+    std::vector<uint32_t> transition_offsets; // transition_times range per transition id
+    std::vector<int> transition_times;        // sorted timesteps each transition was taken
+
+    // Current window: node positions survive between extracts
+    std::vector<uint32_t> window_states; // node id -> state id
+    std::vector<Vector3> state_positions;
+    std::vector<uint8_t> has_position;
+    std::vector<uint32_t> state_stamp, transition_counts;
+    uint32_t stamp = 0;
+};
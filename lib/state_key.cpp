@@ -0,0 +1,154 @@
+#include "state_key.hpp"
+#include <algorithm>
+
+uint64_t StateKey::hash() const {
+    // splitmix64 finaliser over both halves
+    uint64_t h = lo ^ (hi * 0x9e3779b97f4a7c15ULL);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// StateKeyLayout methods
+int StateKeyLayout::add_field(int min_value, int max_value) {
+    if (max_value < min_value) max_value = min_value;
+
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max_value) - min_value) + 1;
+    int width = 0;
+    while (width < 32 && (uint64_t(1) << width) < range) width++;
+    if (total_bits + width > MAX_BITS) return -1;
+
+    fields.push_back(Field{total_bits, width, min_value, max_value});
+    total_bits += width;
+    return static_cast<int>(fields.size()) - 1;
+}
+
+StateKeyLayout StateKeyLayout::uniform(size_t field_count) {
+    StateKeyLayout layout;
+    if (field_count == 0 || field_count > MAX_BITS) return layout;
+
+    int width = static_cast<int>(std::min<size_t>(32, MAX_BITS / field_count));
+    int64_t half = width > 0 ? (int64_t(1) << (width - 1)) : 0;
+    for (size_t i = 0; i < field_count; i++) {
+        layout.add_field(static_cast<int>(-half), static_cast<int>(std::max<int64_t>(half - 1, 0)));
+    }
+    return layout;
+}
+
+bool StateKeyLayout::set(StateKey& key, size_t field, int value) const {
+    const Field& f = fields[field];
+    int clamped = std::max(f.min_value, std::min(f.max_value, value));
+    if (f.width == 0) return clamped == value;
+
+    uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(clamped) - f.min_value);
+    uint64_t mask = (uint64_t(1) << f.width) - 1;
+
+    if (f.shift >= 64) {
+        int shift = f.shift - 64;
+        key.hi = (key.hi & ~(mask << shift)) | (bits << shift);
+        return clamped == value;
+    }
+    key.lo = (key.lo & ~(mask << f.shift)) | (bits << f.shift);
+    if (f.shift + f.width > 64) {
+        // Field straddles the two words
+        int spill = 64 - f.shift;
+        key.hi = (key.hi & ~(mask >> spill)) | (bits >> spill);
+    }
+    return clamped == value;
+}
+
+int StateKeyLayout::get(const StateKey& key, size_t field) const {
+    const Field& f = fields[field];
+    if (f.width == 0) return f.min_value;
+
+    uint64_t bits;
+    if (f.shift >= 64) {
+        bits = key.hi >> (f.shift - 64);
+    } else {
+        bits = key.lo >> f.shift;
+        if (f.shift + f.width > 64) bits |= key.hi << (64 - f.shift);
+    }
+    bits &= (uint64_t(1) << f.width) - 1;
+    return static_cast<int>(static_cast<int64_t>(bits) + f.min_value);
+}
+
+// StateKeyTable methods
+StateKeyTable::StateKeyTable(size_t expected_size) {
+    size_t capacity = 16;
+    while (capacity < expected_size * 2) capacity <<= 1;
+    rehash(capacity);
+}
+
+std::pair<uint32_t, bool> StateKeyTable::insert(const StateKey& key, uint32_t value) {
+    if ((count + 1) * 2 > keys.size()) rehash(keys.size() * 2);
+
+    size_t slot = key.hash() & mask;
+    while (occupied[slot]) {
+        if (keys[slot] == key) return {values[slot], false};
+        slot = (slot + 1) & mask;
+    }
+    occupied[slot] = 1;
+    keys[slot] = key;
+    values[slot] = value;
+    count++;
+    return {value, true};
+}
+
+const uint32_t* StateKeyTable::find(const StateKey& key) const {
+    size_t slot = key.hash() & mask;
+    while (occupied[slot]) {
+        if (keys[slot] == key) return &values[slot];
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+void StateKeyTable::clear() {
+    std::fill(occupied.begin(), occupied.end(), 0);
+    count = 0;
+}
+
+void StateKeyTable::rehash(size_t new_capacity) {
+    std::vector<StateKey> old_keys = std::move(keys);
+    std::vector<uint32_t> old_values = std::move(values);
+    std::vector<uint8_t> old_occupied = std::move(occupied);
+
+    keys.assign(new_capacity, StateKey());
+    values.assign(new_capacity, 0);
+    occupied.assign(new_capacity, 0);
+    mask = new_capacity - 1;
+    count = 0;
+
+    for (size_t i = 0; i < old_keys.size(); i++) {
+        if (old_occupied[i]) insert(old_keys[i], old_values[i]);
+    }
+}
+
+// ShardedStateKeyTable methods
+uint32_t ShardedStateKeyTable::intern(const StateKey& key, uint64_t order) {
+    // High hash bits pick the shard; the shard's table probes with the low bits
+    unsigned shard_index = static_cast<unsigned>(key.hash() >> (64 - SHARD_BITS));
+    Shard& shard = shards[shard_index];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto inserted = shard.index.insert(key, static_cast<uint32_t>(shard.keys.size()));
+    if (inserted.second) {
+        shard.keys.push_back(key);
+        shard.first_seen.push_back(order);
+    } else if (order < shard.first_seen[inserted.first]) {
+        shard.first_seen[inserted.first] = order;
+    }
+    return inserted.first << SHARD_BITS | shard_index;
+}
+
+size_t ShardedStateKeyTable::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) total += shard.keys.size();
+    return total;
+}
+
+uint32_t ShardedStateKeyTable::id_bound() const {
+    size_t largest = 0;
+    for (const Shard& shard : shards) largest = std::max(largest, shard.keys.size());
+    return static_cast<uint32_t>(largest << SHARD_BITS);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <array>
+#include <mutex>
+
+// Fixed-width identity of an abstracted agent state. Every dimension (item
+// quantity, time bucket, reward bucket) owns a bit field inside 128 bits, so
+// states hash and compare as two integers and never go through strings.
+struct StateKey {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const StateKey& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const StateKey& other) const { return !(*this == other); }
+    uint64_t hash() const;
+};
+
+// Bit layout of a StateKey. A field stores (value - min_value) in just enough
+// bits for [min_value, max_value]; values outside that range are clamped.
+class StateKeyLayout {
+public:
+    static constexpr int MAX_BITS = 128;
+
+    // Returns the new field's index, or -1 if it would not fit in 128 bits
+    int add_field(int min_value, int max_value);
+    // Split 128 bits evenly over field_count signed fields (for open-ended
+    // data). Returns an empty layout when there are more fields than bits.
+    static StateKeyLayout uniform(size_t field_count);
+
+    size_t field_count() const { return fields.size(); }
+    int bits_used() const { return total_bits; }
+
+    // Returns false when value had to be clamped into the field's range
+    bool set(StateKey& key, size_t field, int value) const;
+    int get(const StateKey& key, size_t field) const;
+
+private:
+    struct Field {
+        int shift;
+        int width;
+        int min_value;
+        int max_value;
+    };
+
+    std::vector<Field> fields;
+    int total_bits = 0;
+};
+
+// Open-addressing StateKey -> uint32_t map with linear probing. Capacity is a
+// power of two and the table doubles at 50% load so probe runs stay short.
+class StateKeyTable {
+public:
+    explicit StateKeyTable(size_t expected_size = 0);
+
+    // Inserts key -> value unless present; returns the stored value and
+    // whether an insertion happened
+    std::pair<uint32_t, bool> insert(const StateKey& key, uint32_t value);
+    const uint32_t* find(const StateKey& key) const;
+    size_t size() const { return count; }
+    void clear();
+
+private:
+    void rehash(size_t new_capacity);
+
+    std::vector<StateKey> keys;
+    std::vector<uint32_t> values;
+    std::vector<uint8_t> occupied;
+    size_t count = 0;
+    size_t mask = 0;
+};
+
+// Concurrent StateKey interning for parallel builders: keys are spread over
+// independently locked shards by hash. Each key also keeps the smallest
+// "first seen" order value offered for it, so callers can renumber states
+// into a deterministic order once all workers are done.
+class ShardedStateKeyTable {
+public:
+    static constexpr unsigned SHARD_BITS = 6;
+    static constexpr unsigned SHARD_COUNT = 1u << SHARD_BITS;
+
+    // Stable id for key; lowers its first-seen order to `order` if earlier
+    uint32_t intern(const StateKey& key, uint64_t order);
+
+    // Not synchronised: call only after every writer has finished
+    size_t size() const;
+    uint32_t id_bound() const; // every id is below this
+    const StateKey& key(uint32_t id) const { return shards[id & (SHARD_COUNT - 1)].keys[id >> SHARD_BITS]; }
+    uint64_t first_seen(uint32_t id) const { return shards[id & (SHARD_COUNT - 1)].first_seen[id >> SHARD_BITS]; }
+    template <typename Fn>
+    void for_each(Fn&& fn) const { // fn(id)
+        for (unsigned s = 0; s < SHARD_COUNT; s++) {
+            for (size_t i = 0; i < shards[s].keys.size(); i++) fn(static_cast<uint32_t>(i << SHARD_BITS | s));
+        }
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        StateKeyTable index; // key -> slot in keys / first_seen
+        std::vector<StateKey> keys;
+        std::vector<uint64_t> first_seen;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+};
@@ -0,0 +1,134 @@
+#include "state_spec.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+static constexpr float DEFAULT_TIME_BUCKET = 100.0f; // timesteps per time bin
+
+// StateDimensionSpec methods
+int StateDimensionSpec::bin(float value) const {
+    switch (binning) {
+        case Binning::Edges:
+            return static_cast<int>(std::upper_bound(edges.begin(), edges.end(), value) - edges.begin());
+        case Binning::Log: {
+            int magnitude = static_cast<int>(std::floor(std::log2(1.0f + std::fabs(value))));
+            return value < 0 ? -magnitude : magnitude;
+        }
+        case Binning::Uniform:
+        default:
+            // Truncates toward zero like the fixed bucketing this replaced, so
+            // a negative reward of -0.5 still shares bin 0 with +0.5
+            return static_cast<int>(value / width);
+    }
+}
+
+// StateSpec methods
+StateSpec::StateSpec() {
+    reward.item = "reward";
+}
+
+static StateDimensionSpec default_dimension(const std::string& item) {
+    StateDimensionSpec dim;
+    dim.item = item;
+    if (item == "time") dim.width = DEFAULT_TIME_BUCKET;
+    return dim;
+}
+
+StateSpec StateSpec::from_items(const std::vector<std::string>& items) {
+    StateSpec spec;
+    for (const std::string& item : items) spec.dims.push_back(default_dimension(item));
+    return spec;
+}
+
+static bool parse_float(const std::string& text, float& value) {
+    char* end = nullptr;
+    value = std::strtof(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size() && std::isfinite(value);
+}
+
+static bool parse_binning(const std::string& text, StateDimensionSpec& dim) {
+    if (text == "log") {
+        dim.binning = StateDimensionSpec::Binning::Log;
+        return true;
+    }
+    if (!text.empty() && text[0] == '/') {
+        dim.binning = StateDimensionSpec::Binning::Uniform;
+        return parse_float(text.substr(1), dim.width) && dim.width > 0.0f;
+    }
+
+    dim.binning = StateDimensionSpec::Binning::Edges;
+    dim.edges.clear();
+    std::stringstream edges(text);
+    std::string edge;
+    while (std::getline(edges, edge, ',')) {
+        float value;
+        if (!parse_float(edge, value)) return false;
+        if (!dim.edges.empty() && value <= dim.edges.back()) return false;
+        dim.edges.push_back(value);
+    }
+    return !dim.edges.empty();
+}
+
+bool StateSpec::parse(const std::string& text, StateSpec& spec) {
+    spec = StateSpec();
+
+    std::stringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ';')) {
+        entry.erase(0, entry.find_first_not_of(" \t"));
+        entry.erase(entry.find_last_not_of(" \t") + 1);
+        if (entry.empty()) continue;
+
+        size_t colon = entry.find(':');
+        std::string name = entry.substr(0, colon);
+        StateDimensionSpec dim = name == "reward" ? spec.reward : default_dimension(name);
+        if (name.empty() || (colon != std::string::npos && !parse_binning(entry.substr(colon + 1), dim))) {
+            std::cerr << "Invalid state spec entry '" << entry
+                      << "' (expected name, name:/width, name:log or name:edge,edge,...)" << std::endl;
+            return false;
+        }
+
+        if (name == "reward") {
+            spec.reward = dim;
+        } else {
+            spec.dims.push_back(dim);
+        }
+    }
+
+    if (spec.dims.empty()) {
+        std::cerr << "State spec '" << text << "' names no dimensions" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> StateSpec::item_names() const {
+    std::vector<std::string> names;
+    for (const auto& dim : dims) names.push_back(dim.item);
+    return names;
+}
+
+static std::string describe_dimension(const StateDimensionSpec& dim) {
+    std::ostringstream out;
+    out << dim.item;
+    switch (dim.binning) {
+        case StateDimensionSpec::Binning::Log:
+            out << ":log";
+            break;
+        case StateDimensionSpec::Binning::Edges:
+            for (size_t i = 0; i < dim.edges.size(); i++) out << (i == 0 ? ":" : ",") << dim.edges[i];
+            break;
+        case StateDimensionSpec::Binning::Uniform:
+            if (dim.width != 1.0f) out << ":/" << dim.width;
+            break;
+    }
+    return out.str();
+}
+
+std::string StateSpec::describe() const {
+    std::string text;
+    for (const auto& dim : dims) text += describe_dimension(dim) + ";";
+    return text + describe_dimension(reward);
+}
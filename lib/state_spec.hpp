@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Quantisation of one state dimension: how a raw value (item quantity, or
+// timestep for "time") becomes the integer bin stored in a StateKey field.
+struct StateDimensionSpec {
+    enum class Binning {
+        Uniform,   // value / width, truncated toward zero
+        Edges,     // number of bin edges <= value
+        Log        // floor(log2(1 + |value|)), signed
+    };
+
+    std::string item;               // item name or "time"
+    Binning binning = Binning::Uniform;
+    float width = 1.0f;
+    std::vector<float> edges;       // ascending, for Binning::Edges
+
+    int bin(float value) const;
+};
+
+// Declarative state abstraction for the inventory state graphs: which items
+// make up a state and how finely each one (plus time and reward) is binned.
+// Coarser bins merge states, so graph size follows the chosen resolution.
+//
+// Text form, dimensions separated by ';':
+//   name          one bin per unit (time defaults to 100 timesteps per bin)
+//   name:/W       uniform bins W wide
+//   name:log      log2 bins (0, 1, 2-3, 4-7, ...)
+//   name:a,b,c    explicit ascending bin edges
+//   reward:...    binning of total reward (not a dimension; default /1)
+// e.g. "ore_red:0,1,5,10;battery_red:log;time:/250;reward:/2"
+struct StateSpec {
+    std::vector<StateDimensionSpec> dims;
+    StateDimensionSpec reward;
+
+    StateSpec();
+    // Default binning for the given item names
+    static StateSpec from_items(const std::vector<std::string>& items);
+    // Returns false (after printing the problem) on a malformed spec
+    static bool parse(const std::string& text, StateSpec& spec);
+
+    std::vector<std::string> item_names() const;
+    std::string describe() const;
+};
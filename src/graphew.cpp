@@ -6,6 +6,7 @@
 #include "options.hpp"
 #include "swaptube_pixels.hpp"
 #include "replay_parser.hpp"
+#include "replay_follower.hpp"
 #include "force_layout.hpp"
 
 void print_replay_info(const ReplayData& replay) {
@@ -14,10 +15,11 @@ void print_replay_info(const ReplayData& replay) {
     if (!replay.agents.empty()) {
         const auto& sample_agent = replay.agents[0];
         std::cout << "Sample agent " << sample_agent.agent_id << " inventory:" << std::endl;
-        for (const auto& [item, values] : sample_agent.inventory_over_time) {
-            if (!values.empty()) {
-                std::cout << "  " << item << ": " << values.front().value
-                         << " -> " << values.back().value << std::endl;
+        for (size_t item_id = 0; item_id < sample_agent.item_count(); item_id++) {
+            InventorySeries series = sample_agent.inventory_series(static_cast<int>(item_id));
+            if (!series.empty()) {
+                std::cout << "  " << replay.item_name(static_cast<int>(item_id)) << ": " << series.values[0]
+                         << " -> " << series.values[series.size - 1] << std::endl;
             }
         }
 
@@ -48,6 +50,13 @@ int main(int argc, char* argv[]) {
         return EXIT_SUCCESS;
     }
 
+    // -s: how states are abstracted; otherwise chosen from the replay below
+    StateSpec state_spec;
+    if (args.state_spec && !StateSpec::parse(args.state_spec, state_spec)) {
+        cleanup_args(&args);
+        return EXIT_FAILURE;
+    }
+
     auto graph3d = std::make_unique<Graph3D>();
     auto renderer = std::make_unique<GraphRenderer>();
 
@@ -55,13 +64,36 @@ int main(int argc, char* argv[]) {
 
     ReplayData replay;
     std::vector<Vector3> initial_positions; // Declare at function scope for R key access
+    ReplayFollower follower;                                // --follow: tails the replay
+    std::unique_ptr<InventoryGraphSession> live_session;   // --follow: incremental graph builder
+    std::vector<size_t> changed_agents;
 
     if (args.input_file) {
         std::cout << "Loading replay from " << (args.compressed ? "compressed " : "")
                   << "file: " << args.input_file << std::endl;
 
         bool loaded = false;
-        if (args.compressed) {
+        if (args.extra_file_count > 0 && (args.follow || args.single_agent)) {
+            std::cerr << "Several replays can only be aggregated, not followed or filtered by agent\n";
+        } else if (args.follow) {
+            if (args.compressed) {
+                std::cerr << "--follow expects an uncompressed JSON Lines replay\n";
+            } else if (follower.open(args.input_file)) {
+                // Whatever has been written so far; an empty stream is fine
+                follower.poll(replay, changed_agents);
+                loaded = true;
+            }
+        } else if (args.single_agent) {
+            // Index the replay and decode just the requested agent
+            loaded = ReplayParser::open_replay_lazy(args.input_file, args.compressed, replay);
+            std::shared_ptr<const AgentInventoryState> agent = loaded ? replay.get_agent(args.agent_id) : nullptr;
+            if (loaded && !agent) {
+                std::cerr << "Agent " << args.agent_id << " not found in replay\n";
+                loaded = false;
+            } else if (agent) {
+                replay.add_agent(*agent);
+            }
+        } else if (args.compressed) {
             loaded = ReplayParser::parse_compressed_replay_file(args.input_file, replay);
         } else {
             loaded = ReplayParser::parse_replay_file(args.input_file, replay);
@@ -112,21 +144,65 @@ int main(int argc, char* argv[]) {
 
         print_replay_info(replay);
 
-        // Find inventory items that agents actually collected
-        std::vector<std::string> inventory_dims;
-        std::vector<std::string> active_items;
-
-        // Use active items or fallback to first available items
-        if (active_items.size() >= 3) {
-            inventory_dims = {active_items[0], active_items[1], active_items[2]};
-        } else if (active_items.size() >= 2) {
-            inventory_dims = {active_items[0], active_items[1], "time"}; // Use time as Z dimension
-        } else {
-            inventory_dims = {"ore_red", "battery_red", "time"}; // fallback with time
+        // Dense per-timestep inventory for the builders (skipped if it would be too large,
+        // and pointless for a replay that keeps growing)
+        if (!args.follow) {
+            replay.materialize_inventory();
         }
 
+        if (!args.state_spec) {
+            // Find inventory items that agents actually collected
+            std::vector<std::string> inventory_dims;
+            std::vector<std::string> active_items = AgentGraphBuilder::select_state_items(replay, 3);
+
+            // Use active items or fallback to first available items
+            if (active_items.size() >= 3) {
+                inventory_dims = {active_items[0], active_items[1], active_items[2]};
+            } else if (active_items.size() >= 2) {
+                inventory_dims = {active_items[0], active_items[1], "time"}; // Use time as Z dimension
+            } else if (active_items.size() == 1) {
+                inventory_dims = {active_items[0], "time"};
+            } else {
+                inventory_dims = {"ore_red", "battery_red", "time"}; // fallback with time
+            }
+            state_spec = StateSpec::from_items(inventory_dims);
+        }
 
-        AgentGraphBuilder::build_inventory_dimensional_graph(replay, *graph3d, inventory_dims);
+        if (args.follow) {
+            live_session = std::make_unique<InventoryGraphSession>(*graph3d, state_spec);
+            if (!live_session->valid()) {
+                cleanup_args(&args);
+                return EXIT_FAILURE;
+            }
+            for (size_t agent_index : changed_agents) {
+                live_session->update_agent(replay, agent_index);
+            }
+        } else if (args.extra_file_count > 0) {
+            // Stream the remaining episodes through the aggregate one at a time,
+            // so only one replay is held in memory
+            AggregateGraphBuilder aggregate(state_spec);
+            if (!aggregate.valid()) {
+                cleanup_args(&args);
+                return EXIT_FAILURE;
+            }
+            aggregate.add_replay(replay);
+            replay = ReplayData();
+            for (int i = 0; i < args.extra_file_count; i++) {
+                const char* episode_file = args.extra_files[i];
+                ReplayData episode;
+                bool episode_loaded = is_compressed_filename(episode_file)
+                    ? ReplayParser::parse_compressed_replay_file(episode_file, episode)
+                    : ReplayParser::parse_replay_file(episode_file, episode);
+                if (!episode_loaded) {
+                    std::cerr << "Skipping replay that failed to load: " << episode_file << "\n";
+                    continue;
+                }
+                aggregate.add_replay(episode);
+            }
+            aggregate.build(*graph3d);
+        } else {
+            AgentGraphBuilder::build_inventory_dimensional_graph(replay, *graph3d, state_spec);
+        }
 
         // Store initial positions IMMEDIATELY after graph building for 'R' key reset
         for (uint32_t i = 0; i < graph3d->node_count; i++) {
@@ -150,7 +226,9 @@ int main(int argc, char* argv[]) {
     std::cout << "Graph built: " << graph3d->node_count << " nodes, " << graph3d->edge_count << " edges\n";
 
     // Validate that we have data to render
-    if (graph3d->node_count == 0) {
+    if (graph3d->node_count == 0 && args.follow) {
+        std::cout << "Waiting for replay data...\n";
+    } else if (graph3d->node_count == 0) {
         std::cerr << "Error: No graph nodes created from replay data.\n";
         std::cerr << "This may indicate:\n";
         std::cerr << "  - No agents found in the replay file\n";
@@ -160,7 +238,7 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    if (graph3d->edge_count == 0) {
+    if (graph3d->edge_count == 0 && !args.follow) {
         std::cerr << "Warning: No edges created - agents may not have changed inventory states\n";
     }
 
@@ -218,6 +296,20 @@ int main(int argc, char* argv[]) {
     float render_dim = 3.0f;
     renderer->add_slider("RenderDim", &render_dim, 1.0f, 3.0f);
 
+    // Timeline window over a single replay: moving the sliders re-extracts the
+    // graph of [start, start + length) from an index built on first use
+    std::unique_ptr<WindowedStateGraph> timeline;
+    bool timeline_enabled = !args.follow && args.extra_file_count == 0 && replay.max_timestep > 0;
+    float episode_length = static_cast<float>(replay.max_timestep + 1);
+    float window_start = 0.0f;
+    float window_length = episode_length;
+    int applied_window_start = 0;
+    int applied_window_length = static_cast<int>(episode_length);
+    if (timeline_enabled) {
+        renderer->add_slider("Window start", &window_start, 0.0f, episode_length - 1.0f);
+        renderer->add_slider("Window length", &window_length, 1.0f, episode_length);
+    }
+
     // Reset pause countdown and key state tracking (declared at loop scope)
     int reset_pause_frames = 0;
     bool r_key_was_pressed = false;
@@ -325,6 +417,49 @@ int main(int argc, char* argv[]) {
         // Update key state for next frame (MUST be outside the if block)
         r_key_was_pressed = r_key_is_pressed;
 
+        // Feed newly appended replay events to the graph; the layout picks up new nodes
+        if (live_session) {
+            changed_agents.clear();
+            if (follower.poll(replay, changed_agents)) {
+                uint32_t nodes_before = graph3d->node_count;
+                uint32_t edges_before = graph3d->edge_count;
+                for (size_t agent_index : changed_agents) {
+                    live_session->update_agent(replay, agent_index);
+                }
+                for (uint32_t i = static_cast<uint32_t>(initial_positions.size()); i < graph3d->node_count; i++) {
+                    initial_positions.push_back(graph3d->nodes[i].position);
+                }
+                if (graph3d->node_count != nodes_before || graph3d->edge_count != edges_before) {
+                    // Edges can also go: a completed timestep may replace a transition
+                    int edge_change = static_cast<int>(graph3d->edge_count) - static_cast<int>(edges_before);
+                    std::cout << "Follow: +" << (graph3d->node_count - nodes_before) << " nodes, "
+                              << (edge_change >= 0 ? "+" : "") << edge_change << " edges (t=" << replay.max_timestep << ")" << std::endl;
+                }
+            }
+        }
+
+        // Swap in the graph of the selected time window
+        if (timeline_enabled) {
+            int start = static_cast<int>(window_start);
+            int length = std::max(1, static_cast<int>(window_length));
+            if (start != applied_window_start || length != applied_window_length) {
+                if (!timeline) {
+                    timeline = std::make_unique<WindowedStateGraph>(replay, state_spec);
+                    timeline->adopt_full_graph(*graph3d);
+                }
+                timeline->extract(start, start + length, *graph3d);
+                ForceLayoutEngine::restart_layout_step();
+                initial_positions.clear();
+                for (uint32_t i = 0; i < graph3d->node_count; i++) {
+                    initial_positions.push_back(graph3d->nodes[i].position);
+                }
+                applied_window_start = start;
+                applied_window_length = length;
+                std::cout << "Window [" << start << ", " << (start + length) << "): " << graph3d->node_count
+                          << " nodes, " << graph3d->edge_count << " edges" << std::endl;
+            }
+        }
+
         // Apply force layout in real-time if running
         if (force_layout_running) {
             int dummy_remaining = layout_params.iterations; // large number, decremented internally but ignored
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "replay_parser.hpp"
+
+// Micro-benchmark for AgentInventoryState time lookups on a synthetic replay.
+// Compares the old linear scan, the binary-search point lookups and the
+// forward cursor for a full per-timestep, per-item sweep, plus reads from the
+// materialised dense tensor.
+
+static ReplayData make_synthetic_replay(int agent_count, int timesteps) {
+    ReplayData replay;
+    const char* item_names[] = {"ore_red", "ore_blue", "ore_green", "battery_red", "heart", "armor", "laser", "blueprint"};
+    for (const char* name : item_names) {
+        replay.inventory_items.push_back(name);
+        replay.items->intern(name);
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+    for (int a = 0; a < agent_count; a++) {
+        AgentInventoryState agent;
+        agent.agent_id = a;
+        agent.item_table = replay.items;
+
+        std::vector<std::vector<TimestampValue>> per_item(replay.items->size());
+        std::vector<float> qty(replay.items->size(), 0.0f);
+        float total = 0.0f;
+        for (int t = 0; t < timesteps; t++) {
+            for (size_t i = 0; i < per_item.size(); i++) {
+                if (chance(rng) < 0.05f) {
+                    qty[i] = std::max(0.0f, qty[i] + (chance(rng) < 0.7f ? 1.0f : -1.0f));
+                    per_item[i].emplace_back(t, qty[i]);
+                }
+            }
+            if (chance(rng) < 0.02f) {
+                total += 1.0f;
+                agent.reward_over_time.emplace_back(t, 1.0f);
+                agent.total_reward_over_time.emplace_back(t, total);
+            }
+            if (chance(rng) < 0.3f) {
+                agent.location_over_time.push_back({t, Vector3(static_cast<float>(t % 64), static_cast<float>(t / 64), 0)});
+            }
+        }
+        agent.set_inventory_columns(per_item);
+        replay.add_agent(agent);
+    }
+    replay.max_timestep = timesteps - 1;
+    return replay;
+}
+
+// The pre-binary-search implementation, kept here as the reference point
+static float linear_inventory_at_time(const AgentInventoryState& agent, int item_id, int timestep) {
+    InventorySeries series = agent.inventory_series(item_id);
+    float current_value = 0.0f;
+    for (size_t i = 0; i < series.size; i++) {
+        if (series.timesteps[i] <= timestep) {
+            current_value = series.values[i];
+        } else {
+            break;
+        }
+    }
+    return current_value;
+}
+
+template <typename Fn>
+static double time_ms(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int agent_count = argc > 1 ? std::atoi(argv[1]) : 8;
+    int timesteps = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    ReplayData replay = make_synthetic_replay(agent_count, timesteps);
+    int items = static_cast<int>(replay.items->size());
+    std::cout << "Synthetic replay: " << agent_count << " agents, " << timesteps
+              << " timesteps, " << items << " items" << std::endl;
+
+    double linear_sum = 0.0, search_sum = 0.0, cursor_sum = 0.0;
+
+    double linear_ms = time_ms([&] {
+        for (const auto& agent : replay.agents) {
+            for (int t = 0; t < timesteps; t++) {
+                for (int i = 0; i < items; i++) linear_sum += linear_inventory_at_time(agent, i, t);
+            }
+        }
+    });
+
+    double search_ms = time_ms([&] {
+        for (const auto& agent : replay.agents) {
+            for (int t = 0; t < timesteps; t++) {
+                for (int i = 0; i < items; i++) search_sum += agent.get_inventory_at_time(i, t);
+            }
+        }
+    });
+
+    double cursor_ms = time_ms([&] {
+        for (const auto& agent : replay.agents) {
+            AgentTimeCursor cursor(agent);
+            for (int t = 0; t < timesteps; t++) {
+                cursor.advance_to(t);
+                for (int i = 0; i < items; i++) cursor_sum += cursor.inventory(i);
+            }
+        }
+    });
+
+    replay.materialize_inventory();
+    double dense_sum = 0.0;
+    double dense_ms = time_ms([&] {
+        const InventoryTensor& dense = replay.dense_inventory;
+        for (int a = 0; a < dense.agent_count; a++) {
+            for (int t = 0; t < timesteps; t++) {
+                for (int i = 0; i < items; i++) dense_sum += dense.at(a, t, i);
+            }
+        }
+    });
+
+    std::vector<ItemStatistics> stats;
+    double stats_ms = time_ms([&] { stats = AgentGraphBuilder::compute_item_statistics(replay); });
+
+    std::cout << "  linear scan:   " << linear_ms << " ms" << std::endl;
+    std::cout << "  binary search: " << search_ms << " ms" << std::endl;
+    std::cout << "  cursor sweep:  " << cursor_ms << " ms" << std::endl;
+    std::cout << "  dense tensor:  " << dense_ms << " ms" << std::endl;
+    std::cout << "  item stats:    " << stats_ms << " ms (" << stats.size() << " items)" << std::endl;
+
+    if (linear_sum != search_sum || linear_sum != cursor_sum || linear_sum != dense_sum) {
+        std::cerr << "Mismatch between lookup strategies!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}